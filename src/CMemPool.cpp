@@ -1,192 +1,2344 @@
-#include <stdio.h>
-#include <malloc.h>
-#include <string.h>
-#include <assert.h>
-
-#include "CMemPool.h"
-
-/*==============================================================================
-CMemPool:
-Constructor of this class. It allocate memory block from system and create
-a static double linked list to manage all memory unit.
-
-Parameters:
-[in]ulUnitNum
-The number of unit which is a part of memory block.
-
-[in]ulUnitSize
-The size of unit.
-//=============================================================================
-*/
-
-CMemPool::CMemPool(unsigned long ulUnitNum,unsigned long ulUnitSize) :
-   m_pMemBlock(NULL), m_pAllocatedMemBlock(NULL), m_pFreeMemBlock(NULL), 
-   m_ulBlockSize(ulUnitNum * (ulUnitSize+sizeof(struct _Unit))), 
-   m_ulUnitSize(ulUnitSize)
-{
-
-   m_pMemBlock = ::malloc(m_ulBlockSize);          //Allocate a memory block.
-
-   if(NULL != m_pMemBlock)
-   {
-      for(unsigned long i=0; i<ulUnitNum; i++) //Link all mem unit .
-      {
-         struct _Unit *pCurUnit = (struct _Unit *)( (char *)m_pMemBlock + i*(ulUnitSize+sizeof(struct _Unit)) );
-
-         pCurUnit->pPrev = NULL;
-         pCurUnit->pNext = m_pFreeMemBlock;       //Insert the new unit at head.
-
-         if(NULL != m_pFreeMemBlock)
-         {
-            m_pFreeMemBlock->pPrev = pCurUnit;
-         }
-         m_pFreeMemBlock = pCurUnit;
-      }
-   }   
-}
-
-/*==============================================================================
-~CMemPool():
-Destructor of this class. Its task is to free memory block.
-//=============================================================================
-*/
-CMemPool::~CMemPool()
-{
-   ::free(m_pMemBlock);
-}
-
-
-/*==============================================================================
-Alloc:
-To allocate a memory unit. If memory pool can`t provide proper memory unit,
-will call system function.
-
-Parameters:
-[in]ulSize
-Memory unit size.
-
-[in]bUseMemPool
-Whether use memory pool.
-
-Return Values:
-Return a pointer to a memory unit.
-//=============================================================================
-*/  
-void* CMemPool::Alloc(unsigned long ulSize, bool bUseMemPool)
-{
-   if( ulSize > m_ulUnitSize || false == bUseMemPool || 
-      NULL == m_pMemBlock   || NULL == m_pFreeMemBlock)
-   {
-      assert( false );
-      return NULL ;/*malloc(ulSize);*/
-   }
-
-   //Now FreeList isn`t empty
-   struct _Unit *pCurUnit = m_pFreeMemBlock;
-
-   m_pFreeMemBlock = pCurUnit->pNext;           //Get a unit from free linkedlist.
-   if(NULL != m_pFreeMemBlock)
-   {
-      m_pFreeMemBlock->pPrev = NULL;
-   }
-
-   pCurUnit->pNext = m_pAllocatedMemBlock;
-
-   if(NULL != m_pAllocatedMemBlock)
-   {
-      m_pAllocatedMemBlock->pPrev = pCurUnit; 
-   }
-   m_pAllocatedMemBlock = pCurUnit;
-
-   return (void *)((char *)pCurUnit + sizeof(struct _Unit) );
-}
-
-
-/*==============================================================================
-Free:
-To free a memory unit. If the pointer of parameter point to a memory unit,
-then insert it to "Free linked list". Otherwise, call system function "free".
-
-Parameters:
-[in]p
-It point to a memory unit and prepare to free it.
-
-Return Values:
-none
-//=============================================================================
-*/
-void CMemPool::Free( void* p )
-{
-   if(m_pMemBlock<p && p<(void *)((char *)m_pMemBlock + m_ulBlockSize) )
-   {
-      struct _Unit *pCurUnit = (struct _Unit *)((char *)p - sizeof(struct _Unit) );
-
-      m_pAllocatedMemBlock = pCurUnit->pNext;
-      if(NULL != m_pAllocatedMemBlock)
-      {
-         m_pAllocatedMemBlock->pPrev = NULL;
-      }
-
-      pCurUnit->pNext = m_pFreeMemBlock;
-      if(NULL != m_pFreeMemBlock)
-      {
-         m_pFreeMemBlock->pPrev = pCurUnit;
-      }
-
-      m_pFreeMemBlock = pCurUnit;
-   }
-   else
-   {
-      assert(false);
-      /*free(p);*/
-   }
-}
-
-static CMemPool* g_MemPool = NULL;
-
-void luaCreateMem( unsigned int uiSize, unsigned int unitSize )
-{
-   g_MemPool = new CMemPool(uiSize, unitSize);
-}
-
-
-void luaReleaseMem( void* p )
-{
-   g_MemPool->Free(p);
-}
-
-void luaDestroyMem( void )
-{
-   delete g_MemPool;
-}
-
-void *luaReallocMem(void * ptr, size_t size)
-{
-   void *newMem;
-
-   if (!ptr) 
-   {
-      newMem = g_MemPool->Alloc(size);
-      if (!newMem) 
-      { 
-         return NULL; 
-      }
-   } 
-   else 
-   {
-      /* Blindly allocating a new block and copying it, freeing the old block 
-      * Took from https://gist.github.com/reagent/5285365#file-realloc-c
-      */
-      newMem = g_MemPool->Alloc(size);
-
-      if (!newMem) 
-      { 
-         return NULL; 
-      }
-
-      memcpy(newMem, ptr, size);
-      g_MemPool->Free(ptr);
-
-   }
-   return newMem;
-}
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "lua.hpp"
+#include "CmemPool.h"
+
+#if defined(__GNUC__)
+#define MEMPOOL_PREFETCH(p)   __builtin_prefetch((p), 1)
+#else
+#define MEMPOOL_PREFETCH(p)   ((void)0)
+#endif
+
+/*==============================================================================
+_Guard:
+Holds the pool lock for the lifetime of the object when the pool is shared
+by several threads. A pool used by one thread never locks.
+//=============================================================================
+*/
+class CMemPool::_Guard
+{
+private:
+   CMemPool* m_pPool;
+
+public:
+   _Guard(CMemPool* pPool) : m_pPool(pPool->m_bConcurrent ? pPool : NULL)
+   {
+      if(NULL != m_pPool)
+      {
+         m_pPool->m_Lock.lock();
+      }
+   }
+   ~_Guard()
+   {
+      if(NULL != m_pPool)
+      {
+         m_pPool->m_Lock.unlock();
+      }
+   }
+};
+
+//Live concurrent pools, checked before a thread touches a cache at exit.
+static std::mutex          s_RegistryLock;
+static CMemPool*           s_pRegistry = NULL;
+static std::atomic<unsigned long long> s_ullNextId(1);
+
+thread_local struct CMemPool::_ThreadSlots CMemPool::t_Slots;
+thread_local struct CMemPool::_ThreadReaper CMemPool::t_Reaper;
+
+/*==============================================================================
+SlabMap / SlabUnmap / SlabPurge:
+To get an aligned slab from the system and give it back. Slabs are aligned on
+their own size so the slab of any unit is found by masking its address.
+SlabPurge gives the pages of a spare region slab back but keeps it mapped; its
+first page, holding the header and the spare list links, stays.
+//=============================================================================
+*/
+#if defined(_WIN32)
+static void* SlabMap(size_t ulSize)
+{
+   return _aligned_malloc(ulSize, ulSize);
+}
+
+static void SlabUnmap(void* p, size_t ulSize)
+{
+   (void)ulSize;
+   _aligned_free(p);
+}
+
+static bool SlabPurge(void* p, size_t ulSize)
+{
+   (void)p; (void)ulSize;
+   return false;
+}
+#else
+static void* SlabMap(size_t ulSize)
+{
+   char *p = (char *)mmap(NULL, 2*ulSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+
+   if(MAP_FAILED == (void *)p)
+   {
+      return NULL;
+   }
+
+   size_t ulLead = (ulSize - ((size_t)p & (ulSize - 1))) & (ulSize - 1);
+
+   if(0 != ulLead)
+   {
+      munmap(p, ulLead);                      //Trim the mapping to an aligned slab.
+   }
+   munmap(p + ulLead + ulSize, ulSize - ulLead);
+
+   return p + ulLead;
+}
+
+static void SlabUnmap(void* p, size_t ulSize)
+{
+   munmap(p, ulSize);
+}
+
+static bool SlabPurge(void* p, size_t ulSize)
+{
+#if defined(MADV_DONTNEED)
+   return 0 == madvise((char *)p + 4096, ulSize - 4096, MADV_DONTNEED);
+#else
+   (void)p; (void)ulSize;
+   return false;
+#endif
+}
+#endif
+
+/*==============================================================================
+RegionPrepare:
+To ask for transparent huge pages on a region just mapped and to fault its
+pages in ahead of use. Huge pages have to be asked for before the first touch.
+//=============================================================================
+*/
+static void RegionPrepare(char* p, size_t ulSize, bool bHuge, bool bPopulate)
+{
+#if defined(MADV_HUGEPAGE)
+   if(bHuge)
+   {
+      madvise(p, ulSize, MADV_HUGEPAGE);
+   }
+#else
+   (void)bHuge;
+#endif
+   if(bPopulate)
+   {
+#if defined(MADV_POPULATE_WRITE)
+      if(0 == madvise(p, ulSize, MADV_POPULATE_WRITE))
+      {
+         return;
+      }
+#endif
+      for(size_t i=0; i<ulSize; i+=4096)
+      {
+         ((volatile char *)p)[i] = 0;           //Older kernels: touch every page.
+      }
+   }
+}
+
+/*==============================================================================
+CMemPool:
+Constructor of this class. It builds the segregated size classes (16, 32,
+48 ... 128, then four classes for each doubling up to the largest unit size).
+Every class owns a list of aligned slabs, each with its own free list, and
+grows by new slabs on demand. Units carry no header: a free unit keeps its
+free list link in its own first bytes and the class of any unit is read from
+the header of its slab. Every arena has the same classes with slabs of its
+own, so the objects of one type are packed together.
+
+Parameters:
+[in]ulUnitNum
+The number of unit which is a part of memory block. Together with ulUnitSize
+it gives the bytes reserved at creation, spread over the classes from the
+smallest one.
+
+[in]ulUnitSize
+The size of the largest unit. Bigger requests are served by the system.
+
+[in]bConcurrent
+Whether several threads use the pool at the same time. Each thread then
+allocates from its own magazines of free units, refilled from a lock-free
+depot shared by all threads; the slabs are only touched under a lock when
+the depot runs dry or overflows.
+//=============================================================================
+*/
+
+CMemPool::CMemPool(unsigned long ulUnitNum,unsigned long ulUnitSize,bool bConcurrent) :
+   m_ulClassNum(0), m_ulArenaClassNum(0), m_ulMaxUnitSize(0), m_pClassOfSize(NULL),
+   m_iGrowPolicy(MEMPOOL_GROW_GEOMETRIC), m_ulGrowStep(8), m_ulMaxBytes(0),
+   m_ulSlabBytes(0), m_ulSysBytes(0), m_pSysBlocks(NULL), m_pSmallSysBlocks(NULL), m_iMapFlags(MEMPOOL_MAP_SLABS),
+   m_pRegions(NULL), m_pSpareSlabs(NULL), m_ulSpareBytes(0), m_ulPurgedBytes(0), m_ulReserveBytes(0), m_ullBytesCopied(0),
+   m_llLiveBytes(0), m_llPeakBytes(0), m_ulPeakFootprint(0), m_ullSysAllocNum(0), m_ullFailedNum(0),
+   m_bConcurrent(bConcurrent), m_pDepots(NULL), m_pCaches(NULL), m_ullId(0),
+   m_pRegPrev(NULL), m_pRegNext(NULL), m_pFreeThread(NULL), m_pFreeQueue(NULL), m_pFreeSpare(NULL),
+   m_bFreeBusy(false), m_bFreeTrim(false), m_bFreeStop(false)
+{
+   unsigned long ulSize;
+
+   assert(sizeof(struct _Slab) <= SLAB_HEADER_SIZE);
+
+   if(ulUnitSize < MIN_UNIT_SIZE)
+   {
+      ulUnitSize = MIN_UNIT_SIZE;
+   }
+   else if(ulUnitSize > SLAB_SIZE / 8)
+   {
+      ulUnitSize = SLAB_SIZE / 8;             //Keep several units in every slab.
+   }
+   ulUnitSize = (ulUnitSize + MIN_UNIT_SIZE - 1) & ~(unsigned long)(MIN_UNIT_SIZE - 1);
+
+   for(ulSize = MIN_UNIT_SIZE; m_ulArenaClassNum < MAX_CLASS_NUM; ulSize = NextClassSize(ulSize))
+   {
+      if(ulSize > ulUnitSize || m_ulArenaClassNum == MAX_CLASS_NUM - 1)
+      {
+         ulSize = ulUnitSize;                  //Last class is exactly the largest unit.
+      }
+      struct _SizeClass *pClass = &m_Classes[m_ulArenaClassNum++];
+
+      pClass->ulUnitSize = ulSize;
+      pClass->ulStride   = ulSize;                //Units are 16 bytes aligned.
+      pClass->ulUnitNum  = (SLAB_SIZE - SLAB_HEADER_SIZE) / ulSize;
+      pClass->ulSlabNum  = 0;
+      pClass->ulEmptyNum = 0;
+      pClass->ulMagSize  = MAG_BYTES / ulSize;
+      if(pClass->ulMagSize > MAG_MAX_SIZE)
+      {
+         pClass->ulMagSize = MAG_MAX_SIZE;
+      }
+      else if(pClass->ulMagSize < 4)
+      {
+         pClass->ulMagSize = 4;
+      }
+      pClass->iArena     = MEMPOOL_ARENA_OTHER;
+      pClass->pSlabs     = NULL;
+      pClass->pFullSlabs = NULL;
+      if(ulSize == ulUnitSize)
+      {
+         break;
+      }
+   }
+   m_ulMaxUnitSize = ulUnitSize;
+
+   //The other arenas get the same classes.
+   for(int a=0; a<MEMPOOL_ARENA_NUM; a++)
+   {
+      for(unsigned long i=0; i<m_ulArenaClassNum; i++)
+      {
+         m_Classes[a * m_ulArenaClassNum + i] = m_Classes[i];
+         m_Classes[a * m_ulArenaClassNum + i].iArena = a;
+      }
+      m_ulArenaBytes[a] = 0;
+   }
+   m_ulClassNum = m_ulArenaClassNum * MEMPOOL_ARENA_NUM;
+
+   //Map every size (in MIN_UNIT_SIZE steps) to the smallest class holding it.
+   m_pClassOfSize = (unsigned char *)::malloc(ulUnitSize / MIN_UNIT_SIZE + 1);
+   if(m_bConcurrent)
+   {
+      m_pDepots = new (std::nothrow) struct _Depot[m_ulClassNum];
+      for(unsigned long c=0; NULL != m_pDepots && c<m_ulClassNum; c++)
+      {
+         for(unsigned long i=0; i<DEPOT_SLOTS; i++)
+         {
+            m_pDepots[c].pFull[i].store(NULL, std::memory_order_relaxed);
+            m_pDepots[c].pEmpty[i].store(NULL, std::memory_order_relaxed);
+         }
+      }
+
+      std::lock_guard<std::mutex> lock(s_RegistryLock);
+
+      m_ullId = s_ullNextId++;
+      m_pRegNext = s_pRegistry;
+      if(NULL != s_pRegistry)
+      {
+         s_pRegistry->m_pRegPrev = this;
+      }
+      s_pRegistry = this;
+   }
+   if(NULL == m_pClassOfSize || (m_bConcurrent && NULL == m_pDepots))
+   {
+      m_ulMaxUnitSize = 0;                     //Every request goes to the system.
+      return;
+   }
+   for(unsigned long i=0, c=0; i<=ulUnitSize / MIN_UNIT_SIZE; i++)
+   {
+      while(m_Classes[c].ulUnitSize < i * MIN_UNIT_SIZE)
+      {
+         c++;
+      }
+      m_pClassOfSize[i] = (unsigned char)c;
+   }
+
+   //Reserve the initial slabs, one per class in turn starting from the smallest,
+   //in every arena.
+   unsigned long ulSlabNum = (ulUnitNum * ulUnitSize) / SLAB_SIZE;
+
+   for(unsigned long i=0; i<ulSlabNum; i++)
+   {
+      unsigned long c = (i / MEMPOOL_ARENA_NUM) % m_ulArenaClassNum;
+
+      if(false == AddSlab(&m_Classes[(i % MEMPOOL_ARENA_NUM) * m_ulArenaClassNum + c]))
+      {
+         break;
+      }
+   }
+}
+
+/*==============================================================================
+~CMemPool():
+Destructor of this class. Its task is to give every slab and system block
+back to the system, whether their units were freed or not. It costs one call
+per slab and per system block, never one per object.
+//=============================================================================
+*/
+CMemPool::~CMemPool()
+{
+   SetAsyncFree(false);                        //Queued blocks are freed before the slabs go.
+   while(NULL != m_pFreeSpare)
+   {
+      struct _FreeBatch *pBatch = m_pFreeSpare;
+
+      m_pFreeSpare = pBatch->pNext;
+      ::free(pBatch);
+   }
+   if(m_bConcurrent)
+   {
+      {
+         std::lock_guard<std::mutex> lock(s_RegistryLock);
+
+         if(NULL != m_pRegPrev)
+         {
+            m_pRegPrev->m_pRegNext = m_pRegNext;
+         }
+         else
+         {
+            s_pRegistry = m_pRegNext;
+         }
+         if(NULL != m_pRegNext)
+         {
+            m_pRegNext->m_pRegPrev = m_pRegPrev;
+         }
+      }
+      //Thread caches and magazines are plain system memory, their units die with the slabs.
+      while(NULL != m_pCaches)
+      {
+         struct _ThreadCache *pCache = m_pCaches;
+
+         m_pCaches = pCache->pNext;
+         for(unsigned long c=0; c<m_ulClassNum; c++)
+         {
+            ::free(pCache->pLoaded[c]);
+            ::free(pCache->pPrevious[c]);
+         }
+         ::free(pCache->pFreeBatch);
+         ::free(pCache);
+      }
+      for(unsigned long c=0; NULL != m_pDepots && c<m_ulClassNum; c++)
+      {
+         struct _Magazine *pMag;
+
+         while(NULL != (pMag = DepotPop(m_pDepots[c].pFull)))
+         {
+            ::free(pMag);
+         }
+         while(NULL != (pMag = DepotPop(m_pDepots[c].pEmpty)))
+         {
+            ::free(pMag);
+         }
+      }
+      delete[] m_pDepots;
+   }
+   while(NULL != m_pSysBlocks)
+   {
+      struct _SysBlock *pBlock = m_pSysBlocks;
+
+      m_pSysBlocks = pBlock->pNext;
+      ::free(pBlock);
+   }
+   while(NULL != m_pSmallSysBlocks.load(std::memory_order_relaxed))
+   {
+      struct _SysBlock *pBlock = m_pSmallSysBlocks.load(std::memory_order_relaxed);
+
+      m_pSmallSysBlocks.store(pBlock->pNext, std::memory_order_relaxed);
+      ::free(pBlock);
+   }
+   for(unsigned long c=0; c<m_ulClassNum; c++)
+   {
+      while(NULL != m_Classes[c].pSlabs)
+      {
+         ReleaseSlab(m_Classes[c].pSlabs);
+      }
+      while(NULL != m_Classes[c].pFullSlabs)
+      {
+         ReleaseSlab(m_Classes[c].pFullSlabs);
+      }
+   }
+   while(NULL != m_pRegions)
+   {
+      struct _Region *pRegion = m_pRegions;
+
+      m_pRegions = pRegion->pNext;
+      ReleaseRegion(pRegion);
+   }
+   ::free(m_pClassOfSize);
+}
+
+/*==============================================================================
+NextClassSize:
+Size of the class following the one of ulSize. Classes are 16 bytes apart up
+to 128 bytes, after that every doubling is split into four classes so the
+internal fragmentation of a unit stays under 25%.
+//=============================================================================
+*/
+unsigned long CMemPool::NextClassSize(unsigned long ulSize)
+{
+   unsigned long ulStep = MIN_UNIT_SIZE;
+
+   if(ulSize >= 8 * MIN_UNIT_SIZE)
+   {
+      ulStep = 1;
+      while(ulStep * 2 <= ulSize)
+      {
+         ulStep *= 2;
+      }
+      ulStep /= 4;
+   }
+   return ulSize + ulStep;
+}
+
+/*==============================================================================
+SlabLink / SlabUnlink:
+To insert a slab at the head of a slab list, or to remove it from the list.
+//=============================================================================
+*/
+void CMemPool::SlabLink(struct _Slab **ppList, struct _Slab *pSlab)
+{
+   pSlab->pPrev = NULL;
+   pSlab->pNext = *ppList;
+   if(NULL != *ppList)
+   {
+      (*ppList)->pPrev = pSlab;
+   }
+   *ppList = pSlab;
+}
+
+void CMemPool::SlabUnlink(struct _Slab **ppList, struct _Slab *pSlab)
+{
+   if(NULL != pSlab->pPrev)
+   {
+      pSlab->pPrev->pNext = pSlab->pNext;
+   }
+   else
+   {
+      *ppList = pSlab->pNext;
+   }
+   if(NULL != pSlab->pNext)
+   {
+      pSlab->pNext->pPrev = pSlab->pPrev;
+   }
+}
+
+/*==============================================================================
+AddSlab:
+To get one more slab for a class, unless it would cross the upper bound. A
+spare region slab is taken first; when regions are asked for (SetMapping) and
+none is left, a new region is mapped. Otherwise the slab is mapped alone.
+//=============================================================================
+*/
+bool CMemPool::AddSlab(struct _SizeClass *pClass)
+{
+   struct _Slab *pSlab;
+
+   if(NULL == m_pSpareSlabs && MEMPOOL_MAP_SLABS != m_iMapFlags)
+   {
+      AddRegion(0 != (m_iMapFlags & MEMPOOL_MAP_POPULATE));
+   }
+   if(NULL != m_pSpareSlabs)
+   {
+      pSlab = m_pSpareSlabs;
+      if(NULL == pSlab->pBump)                 //Purged, its pages come back.
+      {
+         if(0 != m_ulMaxBytes && Footprint() + SLAB_SIZE > m_ulMaxBytes)
+         {
+            return false;
+         }
+         m_ulPurgedBytes -= SLAB_SIZE;
+      }
+      SlabUnlink(&m_pSpareSlabs, pSlab);
+      pSlab->pRegion->ulSpareNum--;
+      m_ulSpareBytes -= SLAB_SIZE;
+   }
+   else
+   {
+      if(0 != m_ulMaxBytes && Footprint() + SLAB_SIZE > m_ulMaxBytes)
+      {
+         return false;
+      }
+      pSlab = (struct _Slab *)SlabMap(SLAB_SIZE);
+      if(NULL == pSlab)
+      {
+         return false;
+      }
+      pSlab->pRegion = NULL;
+   }
+   pSlab->pClass        = pClass;
+   pSlab->pFreeMemBlock = NULL;
+   pSlab->pBump         = (char *)pSlab + SLAB_HEADER_SIZE;   //Units are carved lazily.
+   pSlab->ulUsedNum     = 0;
+   SlabLink(&pClass->pSlabs, pSlab);
+
+   pClass->ulSlabNum++;
+   pClass->ulEmptyNum++;
+   m_ulSlabBytes += SLAB_SIZE;
+   m_ulArenaBytes[pClass->iArena] += SLAB_SIZE;
+   NoteFootprint();
+
+   return true;
+}
+
+/*==============================================================================
+Grow:
+To add slabs to a class whose slabs are all full, following the growth policy.
+
+Return Values:
+false when not a single slab could be added.
+//=============================================================================
+*/
+bool CMemPool::Grow(struct _SizeClass *pClass)
+{
+   unsigned long ulNum = m_ulGrowStep;
+
+   if(MEMPOOL_GROW_GEOMETRIC == m_iGrowPolicy && pClass->ulSlabNum < ulNum)
+   {
+      ulNum = pClass->ulSlabNum;               //Double the slabs of the class.
+   }
+   if(0 == ulNum)
+   {
+      ulNum = 1;
+   }
+
+   unsigned long i = 0;
+
+   while(i < ulNum && AddSlab(pClass))
+   {
+      i++;
+   }
+   return 0 != i;
+}
+
+/*==============================================================================
+ReleaseSlab:
+To give a slab back to the system. Its units must not be used anymore.
+//=============================================================================
+*/
+void CMemPool::ReleaseSlab(struct _Slab *pSlab)
+{
+   struct _SizeClass *pClass = pSlab->pClass;
+
+   if(pSlab->ulUsedNum == pClass->ulUnitNum)
+   {
+      SlabUnlink(&pClass->pFullSlabs, pSlab);
+   }
+   else
+   {
+      SlabUnlink(&pClass->pSlabs, pSlab);
+   }
+   if(0 == pSlab->ulUsedNum)
+   {
+      pClass->ulEmptyNum--;
+   }
+   pClass->ulSlabNum--;
+   m_ulSlabBytes -= SLAB_SIZE;
+   m_ulArenaBytes[pClass->iArena] -= SLAB_SIZE;
+
+   if(NULL == pSlab->pRegion)
+   {
+      SlabUnmap(pSlab, SLAB_SIZE);
+   }
+   else
+   {
+      pSlab->pClass = NULL;                    //Back to the spare slabs, Trim purges or unmaps them.
+      SlabLink(&m_pSpareSlabs, pSlab);
+      pSlab->pRegion->ulSpareNum++;
+      m_ulSpareBytes += SLAB_SIZE;
+   }
+}
+
+/*==============================================================================
+AddRegion:
+To map one region, aligned on its size so huge pages can back it, and to add
+all its slabs to the spare slabs.
+
+Parameters:
+[in]bPopulate
+Whether the pages of the region are faulted in now.
+//=============================================================================
+*/
+bool CMemPool::AddRegion(bool bPopulate)
+{
+   if(0 != m_ulMaxBytes && Footprint() + REGION_SIZE > m_ulMaxBytes)
+   {
+      return false;
+   }
+
+   struct _Region *pRegion = (struct _Region *)::malloc(sizeof(struct _Region));
+
+   if(NULL == pRegion)
+   {
+      return false;
+   }
+   pRegion->pBase = (char *)SlabMap(REGION_SIZE);
+   if(NULL == pRegion->pBase)
+   {
+      ::free(pRegion);
+      return false;
+   }
+   RegionPrepare(pRegion->pBase, REGION_SIZE, 0 != (m_iMapFlags & MEMPOOL_MAP_HUGEPAGE), bPopulate);
+   pRegion->ulSpareNum = REGION_SLAB_NUM;
+   pRegion->pNext = m_pRegions;
+   m_pRegions = pRegion;
+
+   for(unsigned long i=REGION_SLAB_NUM; i-- > 0; )
+   {
+      struct _Slab *pSlab = (struct _Slab *)(pRegion->pBase + i * SLAB_SIZE);
+
+      pSlab->pClass  = NULL;
+      pSlab->pRegion = pRegion;
+      pSlab->pBump   = (char *)pSlab + SLAB_HEADER_SIZE;   //Not purged.
+      SlabLink(&m_pSpareSlabs, pSlab);       //The lowest slab ends up first.
+   }
+   m_ulSpareBytes += REGION_SIZE;
+   NoteFootprint();
+
+   return true;
+}
+
+/*==============================================================================
+ReleaseRegion:
+To unmap a region none of whose slabs is used. The caller unlinks it from the
+region list.
+//=============================================================================
+*/
+void CMemPool::ReleaseRegion(struct _Region *pRegion)
+{
+   for(unsigned long i=0; i<REGION_SLAB_NUM; i++)
+   {
+      struct _Slab *pSlab = (struct _Slab *)(pRegion->pBase + i * SLAB_SIZE);
+
+      if(NULL == pSlab->pBump)
+      {
+         m_ulPurgedBytes -= SLAB_SIZE;
+      }
+      SlabUnlink(&m_pSpareSlabs, pSlab);
+   }
+   m_ulSpareBytes -= REGION_SIZE;
+   SlabUnmap(pRegion->pBase, REGION_SIZE);
+   ::free(pRegion);
+}
+
+/*==============================================================================
+SysAlloc:
+To allocate a block from the system when the pool can`t serve the request.
+The block is linked in the system block list so the destructor can free it,
+and charged to the arena iArena.
+//=============================================================================
+*/
+void* CMemPool::SysAlloc(unsigned long ulSize, int iArena)
+{
+   if(0 != m_ulMaxBytes && Footprint() + ulSize > m_ulMaxBytes)
+   {
+      return NULL;
+   }
+
+   struct _SysBlock *pBlock = (struct _SysBlock *)::malloc(sizeof(struct _SysBlock) + ulSize);
+
+   if(NULL == pBlock)
+   {
+      return NULL;
+   }
+   SysLink(pBlock);
+   pBlock->ulSize  = ulSize;
+   pBlock->ulArena = iArena;
+   m_ulSysBytes += ulSize;
+   m_ulArenaBytes[iArena] += ulSize;
+   m_ullSysAllocNum++;
+   NoteFootprint();
+
+   return (void *)(pBlock + 1);
+}
+
+/*==============================================================================
+SysFree:
+To give a system block back.
+//=============================================================================
+*/
+void CMemPool::SysFree(void* p)
+{
+   struct _SysBlock *pBlock = (struct _SysBlock *)p - 1;
+
+   m_ulSysBytes -= pBlock->ulSize;
+   m_ulArenaBytes[pBlock->ulArena] -= pBlock->ulSize;
+   SysUnlink(pBlock);
+   ::free(pBlock);
+}
+
+/*==============================================================================
+SysLink / SysUnlink:
+To insert a system block at the head of the system block list, or to remove
+it from the list it is in (the small system block list included).
+//=============================================================================
+*/
+void CMemPool::SysLink(struct _SysBlock *pBlock)
+{
+   pBlock->pPrev = NULL;
+   pBlock->pNext = m_pSysBlocks;
+   if(NULL != m_pSysBlocks)
+   {
+      m_pSysBlocks->pPrev = pBlock;
+   }
+   m_pSysBlocks = pBlock;
+}
+
+void CMemPool::SysUnlink(struct _SysBlock *pBlock)
+{
+   if(NULL != pBlock->pPrev)
+   {
+      pBlock->pPrev->pNext = pBlock->pNext;
+   }
+   else if(m_pSysBlocks == pBlock)
+   {
+      m_pSysBlocks = pBlock->pNext;
+   }
+   else
+   {
+      m_pSmallSysBlocks.store(pBlock->pNext, std::memory_order_relaxed);
+   }
+   if(NULL != pBlock->pNext)
+   {
+      pBlock->pNext->pPrev = pBlock->pPrev;
+   }
+}
+
+/*==============================================================================
+SysKeepSmall:
+To keep a system block whose unit is now sized for the pool, when a shrink
+could not move it into a slab. The block moves to the small system block
+list, so Free and Realloc still know it from a pool unit.
+//=============================================================================
+*/
+void CMemPool::SysKeepSmall(struct _SysBlock *pBlock)
+{
+   struct _SysBlock *pHead = m_pSmallSysBlocks.load(std::memory_order_relaxed);
+
+   SysUnlink(pBlock);
+   pBlock->pPrev = NULL;
+   pBlock->pNext = pHead;
+   if(NULL != pHead)
+   {
+      pHead->pPrev = pBlock;
+   }
+   m_pSmallSysBlocks.store(pBlock, std::memory_order_relaxed);
+}
+
+/*==============================================================================
+IsSmallSys:
+To tell whether p, given with a size the pool serves, is a system block kept
+by SysKeepSmall. That only happens near memory exhaustion, so the list is
+almost always empty and costs the pool units a single load.
+//=============================================================================
+*/
+bool CMemPool::IsSmallSys(void* p)
+{
+   if(NULL == m_pSmallSysBlocks.load(std::memory_order_relaxed))
+   {
+      return false;
+   }
+
+   _Guard guard(this);
+
+   for(struct _SysBlock *pBlock = m_pSmallSysBlocks.load(std::memory_order_relaxed);
+       NULL != pBlock; pBlock = pBlock->pNext)
+   {
+      if(pBlock + 1 == p)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+
+/*==============================================================================
+Alloc:
+To allocate a memory unit of the class that fits ulSize. If memory pool
+can`t provide proper memory unit, will call system function.
+
+Parameters:
+[in]ulSize
+Memory unit size.
+
+[in]iArena
+Arena to take the unit from, MEMPOOL_ARENA_*.
+
+Return Values:
+Return a pointer to a memory unit, NULL when the upper bound is reached.
+//=============================================================================
+*/
+void* CMemPool::Alloc(unsigned long ulSize, int iArena)
+{
+   void *p;
+
+   if( ulSize > m_ulMaxUnitSize )
+   {
+      _Guard guard(this);
+
+      p = SysAlloc(ulSize, iArena);
+      if(NULL != p)
+      {
+         AddLive(ulSize);
+      }
+   }
+   else if(m_bConcurrent)
+   {
+      p = CacheAlloc(ClassOf(ulSize, iArena), ulSize);
+   }
+   else
+   {
+      p = SlabAlloc(ClassOf(ulSize, iArena));
+      if(NULL != p)
+      {
+         AddLive(ulSize);
+      }
+   }
+   if(NULL == p)
+   {
+      m_ullFailedNum.fetch_add(1, std::memory_order_relaxed);
+   }
+   return p;
+}
+
+
+/*==============================================================================
+Free:
+To free a memory unit. If the size is served by the pool, give the unit back
+to the class of its slab. Otherwise, call system function "free".
+
+Parameters:
+[in]p
+It point to a memory unit and prepare to free it.
+
+[in]ulSize
+Size the unit was requested (or last resized) with.
+
+Return Values:
+none
+//=============================================================================
+*/
+void CMemPool::Free( void* p, unsigned long ulSize )
+{
+   if(ulSize > m_ulMaxUnitSize || IsSmallSys(p))
+   {
+      _Guard guard(this);
+      SysFree(p);
+      AddLive(-(long long)ulSize);
+      return;
+   }
+
+   struct _SizeClass *pClass = SlabOf(p)->pClass;
+
+   if(m_bConcurrent)
+   {
+      CacheFree(p, pClass, ulSize);
+   }
+   else
+   {
+      SlabFree(p, pClass);
+      AddLive(-(long long)ulSize);
+   }
+}
+
+
+/*==============================================================================
+FreeMany:
+To free a batch of units, such as the blocks of the dead objects of one sweep
+step. Consecutive units of one slab are linked together and spliced into its
+free list at once, the slab headers of the units ahead are prefetched, and
+the live bytes are counted once for the whole batch. In concurrent mode every
+unit goes to the magazines as with Free, which already batch.
+
+Parameters:
+[in]ppBlocks
+The units, none of them NULL.
+
+[in]pSizes
+Size each unit was requested (or last resized) with.
+
+[in]iNum
+The number of unit.
+//=============================================================================
+*/
+void CMemPool::FreeMany(void** ppBlocks, size_t* pSizes, int iNum)
+{
+   enum { RUN_NUM = 4, PREFETCH_AHEAD = 8 };
+   struct
+   {
+      struct _Slab* pSlab;
+      struct _Unit* pFirst;
+      struct _Unit* pLast;
+      unsigned long ulNum;
+   } aRuns[RUN_NUM];
+   long long llFreed = 0;
+   int iNext = 0;
+
+   if(m_bConcurrent)
+   {
+      for(int i=0; i<iNum; i++)
+      {
+         Free(ppBlocks[i], pSizes[i]);
+      }
+      return;
+   }
+   for(int r=0; r<RUN_NUM; r++)
+   {
+      aRuns[r].pSlab = NULL;
+   }
+   for(int i=0; i<iNum && i<PREFETCH_AHEAD; i++)
+   {
+      MEMPOOL_PREFETCH(ppBlocks[i]);
+   }
+   for(int i=0; i<iNum; i++)
+   {
+      struct _Unit *pCurUnit = (struct _Unit *)ppBlocks[i];
+      int r;
+
+      if(i + PREFETCH_AHEAD < iNum)
+      {
+         MEMPOOL_PREFETCH(ppBlocks[i + PREFETCH_AHEAD]);   //Its link is written soon.
+      }
+      llFreed += pSizes[i];
+      if(pSizes[i] > m_ulMaxUnitSize || IsSmallSys(pCurUnit))
+      {
+         SysFree(pCurUnit);
+         continue;
+      }
+
+      struct _Slab *pSlab = SlabOf(pCurUnit);
+
+      for(r=0; r<RUN_NUM && aRuns[r].pSlab != pSlab; r++)
+      {
+      }
+      if(RUN_NUM == r)                          //No open run of this slab, close the oldest.
+      {
+         r = iNext;
+         iNext = (iNext + 1) % RUN_NUM;
+         if(NULL != aRuns[r].pSlab)
+         {
+            SlabFreeRun(aRuns[r].pSlab, aRuns[r].pFirst, aRuns[r].pLast, aRuns[r].ulNum);
+         }
+         aRuns[r].pSlab = pSlab;
+         aRuns[r].pFirst = NULL;
+         aRuns[r].pLast = pCurUnit;
+         aRuns[r].ulNum = 0;
+      }
+      pCurUnit->pNext = aRuns[r].pFirst;
+      aRuns[r].pFirst = pCurUnit;
+      aRuns[r].ulNum++;
+   }
+   for(int r=0; r<RUN_NUM; r++)
+   {
+      if(NULL != aRuns[r].pSlab)
+      {
+         SlabFreeRun(aRuns[r].pSlab, aRuns[r].pFirst, aRuns[r].pLast, aRuns[r].ulNum);
+      }
+   }
+   AddLive(-llFreed);
+}
+
+
+/*==============================================================================
+CountLive:
+To count bytes becoming live (or dead, llDelta < 0) outside Alloc and Free.
+In concurrent mode the bytes go to the cache of the running thread, so the
+counters of a shared pool are never written by two threads.
+//=============================================================================
+*/
+void CMemPool::CountLive(long long llDelta)
+{
+   if(m_bConcurrent)
+   {
+      struct _ThreadCache *pCache = ThreadCache();
+
+      if(NULL != pCache)
+      {
+         pCache->llLiveBytes.store(pCache->llLiveBytes.load(std::memory_order_relaxed) + llDelta,
+                                   std::memory_order_relaxed);
+         return;
+      }
+   }
+
+   _Guard guard(this);
+   AddLive(llDelta);
+}
+
+
+/*==============================================================================
+SlabAlloc:
+To take a unit from the first slab of a class with a free unit; when every
+slab is full the class grows by new slabs. The caller holds the pool lock in
+concurrent mode.
+//=============================================================================
+*/
+void* CMemPool::SlabAlloc(struct _SizeClass *pClass)
+{
+   if(NULL == pClass->pSlabs && false == Grow(pClass))
+   {
+      return NULL;
+   }
+
+   //Now the first slab has a free unit
+   struct _Slab *pSlab = pClass->pSlabs;
+   struct _Unit *pCurUnit = pSlab->pFreeMemBlock;
+
+   if(NULL != pCurUnit)
+   {
+      pSlab->pFreeMemBlock = pCurUnit->pNext;   //Get a unit from free linkedlist.
+   }
+   else
+   {
+      pCurUnit = (struct _Unit *)pSlab->pBump;  //Carve a unit never used yet.
+      pSlab->pBump += pClass->ulStride;
+   }
+
+   if(0 == pSlab->ulUsedNum++)
+   {
+      pClass->ulEmptyNum--;
+   }
+   if(pSlab->ulUsedNum == pClass->ulUnitNum)
+   {
+      SlabUnlink(&pClass->pSlabs, pSlab);
+      SlabLink(&pClass->pFullSlabs, pSlab);
+   }
+
+   return (void *)pCurUnit;
+}
+
+
+/*==============================================================================
+SlabFree:
+To insert a unit to the "Free linked list" of its slab, found by masking the
+unit address. The caller holds the pool lock in concurrent mode.
+//=============================================================================
+*/
+void CMemPool::SlabFree(void* p, struct _SizeClass *pClass)
+{
+   struct _Unit *pCurUnit = (struct _Unit *)p;     //The link lives in the free unit itself.
+   struct _Slab *pSlab = SlabOf(p);
+
+   assert(pSlab->pClass == pClass);
+
+   pCurUnit->pNext = pSlab->pFreeMemBlock;
+   pSlab->pFreeMemBlock = pCurUnit;
+
+   if(pSlab->ulUsedNum == pClass->ulUnitNum)
+   {
+      SlabUnlink(&pClass->pFullSlabs, pSlab);
+      SlabLink(&pClass->pSlabs, pSlab);
+   }
+   if(0 == --pSlab->ulUsedNum)
+   {
+      pClass->ulEmptyNum++;                     //Released on the next Trim.
+   }
+}
+
+
+/*==============================================================================
+SlabFreeRun:
+To insert ulNum units of one slab, already linked from pFirst to pLast, to the
+"Free linked list" of the slab at once.
+//=============================================================================
+*/
+void CMemPool::SlabFreeRun(struct _Slab *pSlab, struct _Unit *pFirst, struct _Unit *pLast, unsigned long ulNum)
+{
+   struct _SizeClass *pClass = pSlab->pClass;
+
+   assert(ulNum <= pSlab->ulUsedNum);
+
+   pLast->pNext = pSlab->pFreeMemBlock;
+   pSlab->pFreeMemBlock = pFirst;
+
+   if(pSlab->ulUsedNum == pClass->ulUnitNum)
+   {
+      SlabUnlink(&pClass->pFullSlabs, pSlab);
+      SlabLink(&pClass->pSlabs, pSlab);
+   }
+   pSlab->ulUsedNum -= ulNum;
+   if(0 == pSlab->ulUsedNum)
+   {
+      pClass->ulEmptyNum++;                     //Released on the next Trim.
+   }
+}
+
+
+/*==============================================================================
+ThreadCache:
+To find the cache of the running thread for this pool, creating it on first
+use. Slots left by destroyed pools are recycled once all slots are taken.
+
+Return Values:
+NULL when no cache can be had; the caller then goes to the slabs directly.
+//=============================================================================
+*/
+struct CMemPool::_ThreadCache* CMemPool::ThreadCache()
+{
+   struct _ThreadSlots &slots = t_Slots;
+   unsigned long ulFree = CACHE_SLOTS;
+
+   for(unsigned long i=0; i<CACHE_SLOTS; i++)
+   {
+      if(slots.aSlot[i].pPool == this && slots.aSlot[i].ullId == m_ullId)
+      {
+         return slots.aSlot[i].pCache;
+      }
+      if(NULL == slots.aSlot[i].pPool && CACHE_SLOTS == ulFree)
+      {
+         ulFree = i;
+      }
+   }
+
+   if(CACHE_SLOTS == ulFree)
+   {
+      std::lock_guard<std::mutex> lock(s_RegistryLock);
+
+      for(unsigned long i=0; i<CACHE_SLOTS; i++)
+      {
+         if(false == IsAlive(slots.aSlot[i].pPool, slots.aSlot[i].ullId))
+         {
+            slots.aSlot[i].pPool = NULL;       //Its cache died with the pool.
+            ulFree = i;
+         }
+      }
+      if(CACHE_SLOTS == ulFree)
+      {
+         return NULL;
+      }
+   }
+
+   struct _ThreadCache *pCache = (struct _ThreadCache *)::calloc(1, sizeof(struct _ThreadCache));
+
+   if(NULL == pCache)
+   {
+      return NULL;
+   }
+   new (&pCache->llLiveBytes) std::atomic<long long>(0);
+   {
+      _Guard guard(this);
+
+      pCache->pNext = m_pCaches;
+      if(NULL != m_pCaches)
+      {
+         m_pCaches->pPrev = pCache;
+      }
+      m_pCaches = pCache;
+   }
+   slots.aSlot[ulFree].pPool  = this;
+   slots.aSlot[ulFree].ullId  = m_ullId;
+   slots.aSlot[ulFree].pCache = pCache;
+   t_Reaper.bArmed = true;                     //Registers the exit handler of the thread.
+
+   return pCache;
+}
+
+
+/*==============================================================================
+CacheAlloc / CacheFree:
+Fast paths of concurrent mode: pop a unit from, or push it to, the loaded
+magazine of the running thread. No lock and no atomic operation is involved;
+the live bytes are counted in the cache, which only this thread writes.
+A unit freed by another thread than the one which allocated it simply goes
+to the freeing thread's magazine; overflowing magazines flow through the
+depot back to the threads that allocate.
+//=============================================================================
+*/
+void* CMemPool::CacheAlloc(struct _SizeClass *pClass, unsigned long ulSize)
+{
+   struct _ThreadCache *pCache = ThreadCache();
+
+   if(NULL == pCache)
+   {
+      _Guard guard(this);
+      void *p = SlabAlloc(pClass);
+
+      if(NULL != p)
+      {
+         AddLive(ulSize);
+      }
+      return p;
+   }
+
+   struct _Magazine *pMag = pCache->pLoaded[pClass - m_Classes];
+   void *p;
+
+   if(NULL != pMag && 0 != pMag->ulCount)
+   {
+      p = pMag->pUnits[--pMag->ulCount];
+   }
+   else if(NULL == (p = CacheRefill(pCache, pClass)))
+   {
+      return NULL;
+   }
+   pCache->llLiveBytes.store(pCache->llLiveBytes.load(std::memory_order_relaxed) + ulSize,
+                             std::memory_order_relaxed);
+   return p;
+}
+
+void CMemPool::CacheFree(void* p, struct _SizeClass *pClass, unsigned long ulSize)
+{
+   struct _ThreadCache *pCache = ThreadCache();
+
+   if(NULL == pCache)
+   {
+      _Guard guard(this);
+      SlabFree(p, pClass);
+      AddLive(-(long long)ulSize);
+      return;
+   }
+
+   struct _Magazine *pMag = pCache->pLoaded[pClass - m_Classes];
+
+   pCache->llLiveBytes.store(pCache->llLiveBytes.load(std::memory_order_relaxed) - (long long)ulSize,
+                             std::memory_order_relaxed);
+   if(NULL != pMag && pMag->ulCount < pClass->ulMagSize)
+   {
+      pMag->pUnits[pMag->ulCount++] = p;
+      return;
+   }
+   CacheSpill(pCache, p, pClass);
+}
+
+
+/*==============================================================================
+CacheRefill:
+The loaded magazine is empty. Swap it with the previous one if that one has
+units, else exchange the empty magazine for a full one from the depot, else
+fill the magazine from the slabs under the pool lock.
+//=============================================================================
+*/
+void* CMemPool::CacheRefill(struct _ThreadCache *pCache, struct _SizeClass *pClass)
+{
+   unsigned long c = pClass - m_Classes;
+   struct _Magazine *pLoaded = pCache->pLoaded[c];
+   struct _Magazine *pPrevious = pCache->pPrevious[c];
+
+   if(NULL != pPrevious && 0 != pPrevious->ulCount)
+   {
+      pCache->pLoaded[c] = pPrevious;
+      pCache->pPrevious[c] = pLoaded;
+      return pPrevious->pUnits[--pPrevious->ulCount];
+   }
+
+   struct _Magazine *pFull = DepotPop(m_pDepots[c].pFull);
+
+   if(NULL != pFull)
+   {
+      if(NULL != pPrevious && false == DepotPush(m_pDepots[c].pEmpty, pPrevious))
+      {
+         ::free(pPrevious);
+      }
+      pCache->pPrevious[c] = pLoaded;
+      pCache->pLoaded[c] = pFull;
+      return pFull->pUnits[--pFull->ulCount];
+   }
+
+   if(NULL == pLoaded)
+   {
+      pLoaded = DepotPop(m_pDepots[c].pEmpty);
+      if(NULL == pLoaded)
+      {
+         pLoaded = (struct _Magazine *)::malloc(sizeof(struct _Magazine));
+      }
+      if(NULL == pLoaded)
+      {
+         _Guard guard(this);
+         return SlabAlloc(pClass);
+      }
+      pLoaded->ulCount = 0;
+      pCache->pLoaded[c] = pLoaded;
+   }
+
+   {
+      _Guard guard(this);
+
+      while(pLoaded->ulCount < pClass->ulMagSize)
+      {
+         void *pUnit = SlabAlloc(pClass);
+
+         if(NULL == pUnit)
+         {
+            break;
+         }
+         pLoaded->pUnits[pLoaded->ulCount++] = pUnit;
+      }
+   }
+   if(0 == pLoaded->ulCount)
+   {
+      return NULL;
+   }
+   return pLoaded->pUnits[--pLoaded->ulCount];
+}
+
+
+/*==============================================================================
+CacheSpill:
+The loaded magazine is full. Swap it with the previous one if that one has
+room, else hand the previous (full) magazine to the depot, or back to the
+slabs when the depot is full, and load an empty magazine.
+//=============================================================================
+*/
+void CMemPool::CacheSpill(struct _ThreadCache *pCache, void* p, struct _SizeClass *pClass)
+{
+   unsigned long c = pClass - m_Classes;
+   struct _Magazine *pLoaded = pCache->pLoaded[c];
+   struct _Magazine *pPrevious = pCache->pPrevious[c];
+
+   if(NULL != pPrevious && pPrevious->ulCount < pClass->ulMagSize)
+   {
+      pCache->pLoaded[c] = pPrevious;
+      pCache->pPrevious[c] = pLoaded;
+      pPrevious->pUnits[pPrevious->ulCount++] = p;
+      return;
+   }
+
+   if(NULL != pPrevious)
+   {
+      if(DepotPush(m_pDepots[c].pFull, pPrevious))
+      {
+         pPrevious = NULL;
+      }
+      else
+      {
+         _Guard guard(this);
+         FlushMagazine(pPrevious, pClass);    //Reused as the empty magazine.
+      }
+   }
+   if(NULL == pPrevious)
+   {
+      pPrevious = DepotPop(m_pDepots[c].pEmpty);
+      if(NULL == pPrevious)
+      {
+         pPrevious = (struct _Magazine *)::malloc(sizeof(struct _Magazine));
+      }
+      if(NULL == pPrevious)
+      {
+         pCache->pPrevious[c] = NULL;
+         _Guard guard(this);
+         SlabFree(p, pClass);
+         return;
+      }
+      pPrevious->ulCount = 0;
+   }
+   pCache->pPrevious[c] = pLoaded;
+   pCache->pLoaded[c] = pPrevious;
+   pPrevious->pUnits[pPrevious->ulCount++] = p;
+}
+
+
+/*==============================================================================
+FlushMagazine:
+To give all units of a magazine back to their slabs. The caller holds the
+pool lock.
+//=============================================================================
+*/
+void CMemPool::FlushMagazine(struct _Magazine *pMag, struct _SizeClass *pClass)
+{
+   while(0 != pMag->ulCount)
+   {
+      SlabFree(pMag->pUnits[--pMag->ulCount], pClass);
+   }
+}
+
+
+/*==============================================================================
+DepotPush / DepotPop:
+To put a magazine in a free depot slot, or take one out of a used slot. Each
+slot is claimed with a single atomic operation, so no lock is taken and a
+magazine can't be lost or handed out twice.
+//=============================================================================
+*/
+bool CMemPool::DepotPush(std::atomic<struct _Magazine*> *pSlots, struct _Magazine *pMag)
+{
+   for(unsigned long i=0; i<DEPOT_SLOTS; i++)
+   {
+      struct _Magazine *pExpected = NULL;
+
+      if(NULL == pSlots[i].load(std::memory_order_relaxed) &&
+         pSlots[i].compare_exchange_strong(pExpected, pMag, std::memory_order_release,
+                                           std::memory_order_relaxed))
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+struct CMemPool::_Magazine* CMemPool::DepotPop(std::atomic<struct _Magazine*> *pSlots)
+{
+   for(unsigned long i=0; i<DEPOT_SLOTS; i++)
+   {
+      if(NULL != pSlots[i].load(std::memory_order_relaxed))
+      {
+         struct _Magazine *pMag = pSlots[i].exchange(NULL, std::memory_order_acquire);
+
+         if(NULL != pMag)
+         {
+            return pMag;
+         }
+      }
+   }
+   return NULL;
+}
+
+
+/*==============================================================================
+ReleaseCache:
+To give the units of a thread cache back to the slabs and free the cache,
+when its thread exits.
+//=============================================================================
+*/
+void CMemPool::ReleaseCache(struct _ThreadCache *pCache)
+{
+   if(NULL != pCache->pFreeBatch)
+   {
+      QueueBatch(pCache->pFreeBatch, false);  //Frees the thread deferred still happen.
+      pCache->pFreeBatch = NULL;
+   }
+
+   _Guard guard(this);
+
+   for(unsigned long c=0; c<m_ulClassNum; c++)
+   {
+      struct _Magazine *pMags[2] = { pCache->pLoaded[c], pCache->pPrevious[c] };
+
+      for(int i=0; i<2; i++)
+      {
+         if(NULL != pMags[i])
+         {
+            FlushMagazine(pMags[i], &m_Classes[c]);
+            ::free(pMags[i]);
+         }
+      }
+   }
+   AddLive(pCache->llLiveBytes.load(std::memory_order_relaxed));   //The pool keeps the count.
+   if(NULL != pCache->pPrev)
+   {
+      pCache->pPrev->pNext = pCache->pNext;
+   }
+   else
+   {
+      m_pCaches = pCache->pNext;
+   }
+   if(NULL != pCache->pNext)
+   {
+      pCache->pNext->pPrev = pCache->pPrev;
+   }
+   ::free(pCache);
+}
+
+
+/*==============================================================================
+IsAlive:
+Whether pPool is still a live concurrent pool with the id ullId. The caller
+holds the registry lock.
+//=============================================================================
+*/
+bool CMemPool::IsAlive(CMemPool* pPool, unsigned long long ullId)
+{
+   for(CMemPool *pCur = s_pRegistry; NULL != pCur; pCur = pCur->m_pRegNext)
+   {
+      if(pCur == pPool && pCur->m_ullId == ullId)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+
+/*==============================================================================
+~_ThreadReaper:
+Runs when a thread that created a cache exits: the caches it owns in live
+pools are given back.
+//=============================================================================
+*/
+CMemPool::_ThreadReaper::~_ThreadReaper()
+{
+   std::lock_guard<std::mutex> lock(s_RegistryLock);
+   struct _ThreadSlots &slots = t_Slots;
+
+   for(unsigned long i=0; i<CACHE_SLOTS; i++)
+   {
+      if(NULL != slots.aSlot[i].pPool && IsAlive(slots.aSlot[i].pPool, slots.aSlot[i].ullId))
+      {
+         slots.aSlot[i].pPool->ReleaseCache(slots.aSlot[i].pCache);
+      }
+      slots.aSlot[i].pPool = NULL;
+   }
+}
+
+
+/*==============================================================================
+Realloc:
+To resize a memory unit. The unit is kept in place while the new size still
+fits in it and does not leave more than half of it unused (or still maps to
+the same class). Otherwise a unit of the proper class of the same arena is
+allocated and only
+min(ulOldSize, ulNewSize) bytes are copied. Blocks bigger than the largest
+class are resized with the system "realloc", which can extend them in place;
+a system block shrinking to a pool size moves to a unit. As the lua_Alloc
+contract asks, a shrink never fails: when no unit can be had the block is
+kept as it is, a system block then joining the small system block list.
+
+Parameters:
+[in]p
+It point to a memory unit, or NULL to allocate a new one.
+
+[in]ulOldSize
+Size the caller requested for the unit, ignored when p is NULL.
+
+[in]ulNewSize
+New size of the unit.
+
+[in]iArena
+Arena of a new unit (p NULL). A resized unit stays in its arena.
+
+Return Values:
+Return a pointer to the resized unit, NULL when a growth fails (p is left
+untouched).
+//=============================================================================
+*/
+void* CMemPool::Realloc(void* p, unsigned long ulOldSize, unsigned long ulNewSize, int iArena)
+{
+   if(NULL == p)
+   {
+      return Alloc(ulNewSize, iArena);
+   }
+
+   bool bSmallSys = ulOldSize <= m_ulMaxUnitSize && IsSmallSys(p);
+
+   if(ulOldSize <= m_ulMaxUnitSize && !bSmallSys)
+   {
+      struct _SizeClass *pClass = SlabOf(p)->pClass;
+      unsigned long ulUnitSize = pClass->ulUnitSize;
+
+      if(ulNewSize <= ulUnitSize &&
+         (2*ulNewSize > ulUnitSize || ClassOf(ulNewSize, pClass->iArena) == pClass))
+      {
+         CountLive((long long)ulNewSize - (long long)ulOldSize);
+         return p;                               //Grow or shrink in place.
+      }
+      iArena = pClass->iArena;
+   }
+   else if(ulNewSize > m_ulMaxUnitSize && !bSmallSys)
+   {
+      _Guard guard(this);
+      return SysRealloc(p, ulOldSize, ulNewSize);   //Stay a system block.
+   }
+   else
+   {
+      iArena = (int)((struct _SysBlock *)p - 1)->ulArena;
+   }
+
+   void *pNew = Alloc(ulNewSize, iArena);
+
+   if(NULL == pNew)
+   {
+      if(ulNewSize > ulOldSize)
+      {
+         return NULL;
+      }
+      if(ulOldSize > m_ulMaxUnitSize)
+      {
+         _Guard guard(this);
+         SysKeepSmall((struct _SysBlock *)p - 1);
+      }
+      CountLive((long long)ulNewSize - (long long)ulOldSize);
+      return p;                                  //A shrink never fails, keep the block.
+   }
+
+   unsigned long ulCopy = ulOldSize < ulNewSize ? ulOldSize : ulNewSize;
+
+   memcpy(pNew, p, ulCopy);
+   m_ullBytesCopied.fetch_add(ulCopy, std::memory_order_relaxed);
+   Free(p, ulOldSize);
+
+   return pNew;
+}
+
+/*==============================================================================
+SysRealloc:
+To resize a block obtained from the system. The system allocator grows the
+block into the adjacent free memory when it can, so the bytes are only counted
+as copied when the block actually moved.
+//=============================================================================
+*/
+void* CMemPool::SysRealloc(void* p, unsigned long ulOldSize, unsigned long ulNewSize)
+{
+   struct _SysBlock *pBlock = (struct _SysBlock *)p - 1;
+   unsigned long ulSize = pBlock->ulSize;
+
+   if(0 != m_ulMaxBytes && ulNewSize > ulSize && Footprint() + (ulNewSize - ulSize) > m_ulMaxBytes)
+   {
+      return NULL;
+   }
+
+   SysUnlink(pBlock);
+
+   struct _SysBlock *pNewBlock = (struct _SysBlock *)::realloc(pBlock, sizeof(struct _SysBlock) + ulNewSize);
+
+   if(NULL == pNewBlock)
+   {
+      SysLink(pBlock);
+      return NULL;
+   }
+   SysLink(pNewBlock);
+   if(pNewBlock != pBlock)
+   {
+      m_ullBytesCopied.fetch_add(ulOldSize < ulNewSize ? ulOldSize : ulNewSize, std::memory_order_relaxed);
+   }
+
+   pNewBlock->ulSize = ulNewSize;
+   m_ulSysBytes = m_ulSysBytes - ulSize + ulNewSize;
+   m_ulArenaBytes[pNewBlock->ulArena] = m_ulArenaBytes[pNewBlock->ulArena] - ulSize + ulNewSize;
+   AddLive((long long)ulNewSize - (long long)ulOldSize);
+   NoteFootprint();
+
+   return (void *)(pNewBlock + 1);
+}
+
+/*==============================================================================
+UnitSize:
+Usable size of the memory unit pointed by p, requested with ulSize bytes.
+//=============================================================================
+*/
+unsigned long CMemPool::UnitSize( void* p, unsigned long ulSize )
+{
+   return (ulSize > m_ulMaxUnitSize || IsSmallSys(p)) ? ulSize : SlabOf(p)->pClass->ulUnitSize;
+}
+
+/*==============================================================================
+AlignClass:
+To start every unit of the class holding ulSize bytes on a cache line, for hot
+objects (Table, CallInfo ...) that must not share a line with their
+neighbours. The stride of the class is rounded up to a multiple of the cache
+line in every arena, which costs the padding of every unit.
+
+Parameters:
+[in]ulSize
+A size served by the class.
+
+Return Values:
+false when the size is not served by the pool or when units of the class are
+in use in some arena; its slabs, all empty, are otherwise carved again with
+the new stride.
+//=============================================================================
+*/
+bool CMemPool::AlignClass(unsigned long ulSize)
+{
+   if(0 == ulSize || ulSize > m_ulMaxUnitSize)
+   {
+      return false;
+   }
+
+   _Guard guard(this);
+   bool bAligned = true;
+
+   for(int a=0; a<MEMPOOL_ARENA_NUM; a++)
+   {
+      struct _SizeClass *pClass = ClassOf(ulSize, a);
+
+      if(pClass->ulEmptyNum != pClass->ulSlabNum)
+      {
+         bAligned = false;
+         continue;
+      }
+      pClass->ulStride  = (pClass->ulUnitSize + CACHE_LINE - 1) & ~(unsigned long)(CACHE_LINE - 1);
+      pClass->ulUnitNum = (SLAB_SIZE - SLAB_HEADER_SIZE) / pClass->ulStride;
+
+      for(struct _Slab *pSlab = pClass->pSlabs; NULL != pSlab; pSlab = pSlab->pNext)
+      {
+         pSlab->pFreeMemBlock = NULL;
+         pSlab->pBump         = (char *)pSlab + SLAB_HEADER_SIZE;
+      }
+   }
+   return bAligned;
+}
+
+/*==============================================================================
+SetGrowth:
+To choose how the pool grows when a class runs out of free units.
+
+Parameters:
+[in]iPolicy
+MEMPOOL_GROW_LINEAR adds ulStep slabs, MEMPOOL_GROW_GEOMETRIC doubles the slabs
+of the class but adds no more than ulStep at once.
+
+[in]ulStep
+Number of slabs, see iPolicy.
+
+[in]ulMaxBytes
+Upper bound of the memory taken from the system (slabs and system blocks),
+0 for no bound. Allocations crossing it fail.
+//=============================================================================
+*/
+void CMemPool::SetGrowth(int iPolicy, unsigned long ulStep, size_t ulMaxBytes)
+{
+   _Guard guard(this);
+
+   m_iGrowPolicy = iPolicy;
+   m_ulGrowStep  = (0 != ulStep) ? ulStep : 1;
+   m_ulMaxBytes  = ulMaxBytes;
+}
+
+/*==============================================================================
+SetAsyncFree:
+To start (or stop) the free thread. Blocks given to FreeLater are then queued
+by the thread freeing them, in batches of FREE_BATCH_SIZE, and freed by the
+free thread through its own cache; their units flow back to the allocating
+threads through the depot as usual. Only a concurrent pool can do it, since
+units are freed by another thread than the one using the pool. Stopping hands
+over the blocks every thread still holds and waits until all are freed, so it
+must not run while another thread frees through the pool.
+
+Return Values:
+true when frees are deferred (or no longer are, bOn false).
+//=============================================================================
+*/
+bool CMemPool::SetAsyncFree(bool bOn)
+{
+   if(bOn)
+   {
+      if(NULL == m_pFreeThread && m_bConcurrent && 0 != m_ulMaxUnitSize)
+      {
+         m_bFreeStop = false;
+         try
+         {
+            m_pFreeThread = new std::thread(&CMemPool::FreeThreadMain, this);
+         }
+         catch(...)
+         {
+            m_pFreeThread = NULL;
+         }
+      }
+      return NULL != m_pFreeThread;
+   }
+   if(NULL != m_pFreeThread)
+   {
+      {
+         _Guard guard(this);
+
+         for(struct _ThreadCache *pCache = m_pCaches; NULL != pCache; pCache = pCache->pNext)
+         {
+            if(NULL != pCache->pFreeBatch)
+            {
+               QueueBatch(pCache->pFreeBatch, false);
+               pCache->pFreeBatch = NULL;
+            }
+         }
+      }
+      {
+         std::lock_guard<std::mutex> lock(m_FreeLock);
+
+         m_bFreeStop = true;
+      }
+      m_FreeWake.notify_one();
+      m_pFreeThread->join();                   //It drains the queue before leaving.
+      delete m_pFreeThread;
+      m_pFreeThread = NULL;
+   }
+   return true;
+}
+
+
+/*==============================================================================
+FreeLater:
+To free a unit on the free thread: the block is only appended to the batch of
+the running thread, which is handed over once full. Without a free thread (or
+a cache) the unit is freed at once.
+//=============================================================================
+*/
+void CMemPool::FreeLater(void* p, unsigned long ulSize)
+{
+   struct _ThreadCache *pCache = (NULL != m_pFreeThread) ? ThreadCache() : NULL;
+
+   if(NULL == pCache)
+   {
+      Free(p, ulSize);
+      return;
+   }
+
+   struct _FreeBatch *pBatch = pCache->pFreeBatch;
+
+   if(NULL == pBatch && NULL == (pBatch = pCache->pFreeBatch = TakeBatch()))
+   {
+      Free(p, ulSize);
+      return;
+   }
+   pBatch->aBlocks[pBatch->ulCount].p = p;
+   pBatch->aBlocks[pBatch->ulCount].ulSize = ulSize;
+   if(FREE_BATCH_SIZE == ++pBatch->ulCount)
+   {
+      pCache->pFreeBatch = NULL;
+      QueueBatch(pBatch, false);
+   }
+}
+
+
+/*==============================================================================
+FlushFrees / DrainFrees:
+FlushFrees hands the partial batch of the running thread over, and with bTrim
+asks the free thread to Trim once the queue is empty: the empty slabs are then
+unmapped off the threads running Lua too. DrainFrees also waits until every
+queued block is freed.
+
+Return Values:
+DrainFrees returns false when frees are not deferred.
+//=============================================================================
+*/
+void CMemPool::FlushFrees(bool bTrim)
+{
+   struct _ThreadCache *pCache = (NULL != m_pFreeThread) ? ThreadCache() : NULL;
+
+   if(NULL != pCache && NULL != pCache->pFreeBatch)
+   {
+      QueueBatch(pCache->pFreeBatch, bTrim);
+      pCache->pFreeBatch = NULL;
+   }
+   else if(NULL != m_pFreeThread && bTrim)
+   {
+      QueueBatch(NULL, true);
+   }
+}
+
+bool CMemPool::DrainFrees()
+{
+   if(NULL == m_pFreeThread)
+   {
+      return false;
+   }
+   FlushFrees(false);
+
+   std::unique_lock<std::mutex> lock(m_FreeLock);
+
+   while(NULL != m_pFreeQueue || m_bFreeBusy)
+   {
+      m_FreeIdle.wait(lock);
+   }
+   return true;
+}
+
+
+/*==============================================================================
+TakeBatch / QueueBatch:
+To get an empty batch, reused when one is spare, and to hand a batch (which
+may be NULL to only ask for a Trim) to the free thread.
+//=============================================================================
+*/
+struct CMemPool::_FreeBatch* CMemPool::TakeBatch()
+{
+   struct _FreeBatch *pBatch;
+
+   {
+      std::lock_guard<std::mutex> lock(m_FreeLock);
+
+      pBatch = m_pFreeSpare;
+      if(NULL != pBatch)
+      {
+         m_pFreeSpare = pBatch->pNext;
+      }
+   }
+   if(NULL == pBatch)
+   {
+      pBatch = (struct _FreeBatch *)::malloc(sizeof(struct _FreeBatch));
+   }
+   if(NULL != pBatch)
+   {
+      pBatch->ulCount = 0;
+   }
+   return pBatch;
+}
+
+void CMemPool::QueueBatch(struct _FreeBatch *pBatch, bool bTrim)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_FreeLock);
+
+      if(NULL != pBatch)
+      {
+         pBatch->pNext = m_pFreeQueue;
+         m_pFreeQueue = pBatch;
+      }
+      m_bFreeTrim = m_bFreeTrim || bTrim;
+   }
+   m_FreeWake.notify_one();
+}
+
+
+/*==============================================================================
+FreeBatch:
+To free the blocks of a batch, run by the free thread without its lock.
+//=============================================================================
+*/
+void CMemPool::FreeBatch(struct _FreeBatch *pBatch)
+{
+   for(unsigned long i=0; i<pBatch->ulCount; i++)
+   {
+      Free(pBatch->aBlocks[i].p, pBatch->aBlocks[i].ulSize);
+   }
+}
+
+
+/*==============================================================================
+FreeThreadMain:
+Body of the free thread: free the queued batches, then Trim when asked, then
+sleep. It leaves on stop once the queue is empty.
+//=============================================================================
+*/
+void CMemPool::FreeThreadMain()
+{
+   std::unique_lock<std::mutex> lock(m_FreeLock);
+
+   for(;;)
+   {
+      if(NULL != m_pFreeQueue)
+      {
+         struct _FreeBatch *pBatch = m_pFreeQueue;
+
+         m_pFreeQueue = pBatch->pNext;
+         m_bFreeBusy = true;
+         lock.unlock();
+         FreeBatch(pBatch);
+         lock.lock();
+         m_bFreeBusy = false;
+         pBatch->pNext = m_pFreeSpare;
+         m_pFreeSpare = pBatch;
+      }
+      else if(m_bFreeTrim)
+      {
+         m_bFreeTrim = false;
+         m_bFreeBusy = true;
+         lock.unlock();
+         Trim();
+         lock.lock();
+         m_bFreeBusy = false;
+      }
+      else
+      {
+         m_FreeIdle.notify_all();
+         if(m_bFreeStop)
+         {
+            break;
+         }
+         m_FreeWake.wait(lock);
+      }
+   }
+}
+
+
+/*==============================================================================
+Trim:
+To give the empty slabs back to the system. One empty slab is kept for every
+class so a class going back and forth around a slab boundary does not map and
+unmap on every collection. In concurrent mode the full magazines waiting in
+the depot are given back to their slabs first; units cached by the threads
+themselves keep their slabs alive. Regions are unmapped once all their slabs
+are spare, and the pages of the other spare slabs are purged (SlabPurge), so
+one live unit does not keep a whole region resident. Neither goes below the
+footprint reserved by Prefault.
+
+Parameters:
+[in]bAll
+true to release the slab kept for every class as well, when the state is
+being trimmed on purpose (LUA_GCTRIM) rather than after a collection.
+
+Return Values:
+Number of bytes released.
+//=============================================================================
+*/
+size_t CMemPool::Trim(bool bAll)
+{
+   _Guard guard(this);
+   size_t ulBefore = Footprint();
+
+   for(unsigned long c=0; c<m_ulClassNum; c++)
+   {
+      struct _SizeClass *pClass = &m_Classes[c];
+      struct _Magazine *pMag;
+
+      while(NULL != m_pDepots && NULL != (pMag = DepotPop(m_pDepots[c].pFull)))
+      {
+         FlushMagazine(pMag, pClass);
+         if(false == DepotPush(m_pDepots[c].pEmpty, pMag))
+         {
+            ::free(pMag);
+         }
+      }
+
+      struct _Slab *pSlab = pClass->pSlabs;
+
+      while(NULL != pSlab && pClass->ulEmptyNum > (bAll ? 0UL : 1UL))
+      {
+         struct _Slab *pNext = pSlab->pNext;
+
+         if(0 == pSlab->ulUsedNum)
+         {
+            ReleaseSlab(pSlab);
+         }
+         pSlab = pNext;
+      }
+   }
+
+   struct _Region **ppRegion = &m_pRegions;
+
+   while(NULL != *ppRegion)
+   {
+      struct _Region *pRegion = *ppRegion;
+
+      if(REGION_SLAB_NUM == pRegion->ulSpareNum && Footprint() >= m_ulReserveBytes + REGION_SIZE)
+      {
+         *ppRegion = pRegion->pNext;
+         ReleaseRegion(pRegion);
+      }
+      else
+      {
+         ppRegion = &pRegion->pNext;
+      }
+   }
+   for(struct _Slab *pSlab = m_pSpareSlabs; NULL != pSlab && Footprint() >= m_ulReserveBytes + SLAB_SIZE;
+       pSlab = pSlab->pNext)
+   {
+      if(NULL != pSlab->pBump && SlabPurge(pSlab, SLAB_SIZE))
+      {
+         pSlab->pBump = NULL;                  //Marks it purged.
+         m_ulPurgedBytes += SLAB_SIZE;
+      }
+   }
+   return ulBefore - Footprint();
+}
+
+/*==============================================================================
+SetMapping:
+To choose how the slabs mapped from now on are backed. Slabs already mapped
+keep their backing.
+
+Parameters:
+[in]iFlags
+MEMPOOL_MAP_SLABS maps every slab alone. MEMPOOL_MAP_HUGEPAGE and
+MEMPOOL_MAP_POPULATE carve the slabs from 2 MB regions, aligned for
+transparent huge pages and/or prefaulted as soon as they are mapped.
+//=============================================================================
+*/
+void CMemPool::SetMapping(int iFlags)
+{
+   _Guard guard(this);
+
+   m_iMapFlags = iFlags;
+}
+
+/*==============================================================================
+Prefault:
+To map and fault in regions up front, so a worker is warm before it takes
+traffic, and to keep them: Trim does not go under this footprint anymore.
+Only with regions (see SetMapping).
+
+Parameters:
+[in]ulBytes
+Footprint to reach, and to keep.
+
+Return Values:
+The footprint of the pool.
+//=============================================================================
+*/
+size_t CMemPool::Prefault(size_t ulBytes)
+{
+   _Guard guard(this);
+
+   if(MEMPOOL_MAP_SLABS != m_iMapFlags)
+   {
+      m_ulReserveBytes = ulBytes;
+      while(Footprint() < ulBytes && AddRegion(true))
+      {
+      }
+   }
+   return Footprint();
+}
+
+/*==============================================================================
+Pressure:
+How close the pool is to its upper bound (see SetGrowth), for the collector
+to pace itself: it collects earlier as the pool fills up and relaxes while
+there is room. Free units of partly used slabs only serve their own class,
+so they count as taken; a fragmented pool reads fuller than its live bytes.
+
+A pool without bound cannot tell: the free units a sweep leaves are room to
+allocate into without mapping new slabs, not a reason to collect sooner.
+
+Return Values:
+0 to 100, or -1 for a pool without bound.
+//=============================================================================
+*/
+int CMemPool::Pressure()
+{
+   _Guard guard(this);
+
+   if(0 == m_ulMaxBytes)
+   {
+      return -1;
+   }
+
+   size_t ulTaken = Footprint() - (m_ulSpareBytes - m_ulPurgedBytes);   //Spare region slabs serve any class.
+
+   return (ulTaken >= m_ulMaxBytes) ? 100 : (int)(ulTaken * 100 / m_ulMaxBytes);
+}
+
+/*==============================================================================
+Stats:
+To take a snapshot of the pool. Everything is read from the slabs and the
+counters under the lock, so the allocation paths pay nothing for it but one
+addition.
+
+Parameters:
+[out]pStats
+Filled with the snapshot, see MemPoolStats.
+//=============================================================================
+*/
+void CMemPool::Stats(MemPoolStats* pStats)
+{
+   _Guard guard(this);
+   long long llLive = m_llLiveBytes;
+
+   memset(pStats, 0, sizeof(*pStats));
+   for(struct _ThreadCache *pCache = m_pCaches; NULL != pCache; pCache = pCache->pNext)
+   {
+      llLive += pCache->llLiveBytes.load(std::memory_order_relaxed);
+   }
+   if(llLive > m_llPeakBytes)
+   {
+      m_llPeakBytes = llLive;                  //Sampled in concurrent mode.
+   }
+   pStats->m_liveBytes     = (size_t)llLive;
+   pStats->m_peakBytes     = (size_t)m_llPeakBytes;
+   pStats->m_footprint     = Footprint();
+   pStats->m_spareBytes    = m_ulSpareBytes - m_ulPurgedBytes;
+   pStats->m_peakFootprint = m_ulPeakFootprint;
+   pStats->m_sysBytes      = m_ulSysBytes;
+   pStats->m_failedNum     = m_ullFailedNum.load(std::memory_order_relaxed);
+   pStats->m_sysAllocNum   = m_ullSysAllocNum;
+   for(int a=0; a<MEMPOOL_ARENA_NUM; a++)
+   {
+      pStats->m_arenaBytes[a] = m_ulArenaBytes[a];
+   }
+
+   //The classes of all arenas are summed by size.
+   pStats->m_classNum = m_ulArenaClassNum;
+   for(unsigned long c=0; c<m_ulClassNum; c++)
+   {
+      struct _SizeClass *pClass = &m_Classes[c];
+      MemPoolClassStats *pClassStats = &pStats->m_classes[c % m_ulArenaClassNum];
+      struct _Slab *pLists[2] = { pClass->pSlabs, pClass->pFullSlabs };
+
+      pClassStats->m_unitSize = pClass->ulUnitSize;
+      pClassStats->m_slabNum += pClass->ulSlabNum;
+      for(int i=0; i<2; i++)
+      {
+         for(struct _Slab *pSlab = pLists[i]; NULL != pSlab; pSlab = pSlab->pNext)
+         {
+            unsigned long ulCarved = (pSlab->pBump - ((char *)pSlab + SLAB_HEADER_SIZE)) / pClass->ulStride;
+
+            pClassStats->m_usedNum     += pSlab->ulUsedNum;
+            pClassStats->m_uncarvedNum += pClass->ulUnitNum - ulCarved;
+            pClassStats->m_freeListNum += ulCarved - pSlab->ulUsedNum;
+         }
+      }
+   }
+   for(unsigned long i=0; i<m_ulArenaClassNum; i++)
+   {
+      pStats->m_unitBytes += (size_t)pStats->m_classes[i].m_usedNum * pStats->m_classes[i].m_unitSize;
+   }
+   if(0 != pStats->m_unitBytes && pStats->m_liveBytes >= pStats->m_sysBytes)
+   {
+      double dRequested = (double)(pStats->m_liveBytes - pStats->m_sysBytes);
+
+      pStats->m_fragmentation = (dRequested < pStats->m_unitBytes) ? 1.0 - dRequested / pStats->m_unitBytes : 0.0;
+   }
+}
+
+CMemPool* luaCreateMem( unsigned int uiSize, unsigned int unitSize )
+{
+   return new (std::nothrow) CMemPool(uiSize, unitSize);
+}
+
+CMemPool* luaCreateSharedMem( unsigned int uiSize, unsigned int unitSize )
+{
+   return new (std::nothrow) CMemPool(uiSize, unitSize, true);
+}
+
+void luaDestroyMem( CMemPool* pool )
+{
+   delete pool;
+}
+
+void luaReleaseMem( CMemPool* pool, void* p, size_t osize )
+{
+   pool->Free(p, osize);
+}
+
+/* Arena of a new object of Lua type 'tag' (with its variant bits), the hint
+* lua_Alloc gets in 'osize' when 'ptr' is NULL. It is 0 for untyped blocks.
+*/
+static int ArenaOfType( size_t tag )
+{
+   switch (tag & 0x0F)
+   {
+      case LUA_TSTRING:   return MEMPOOL_ARENA_STRING;
+      case LUA_TTABLE:    return MEMPOOL_ARENA_TABLE;
+      case LUA_TFUNCTION: return MEMPOOL_ARENA_FUNCTION;
+      case LUA_NUMTAGS:   return MEMPOOL_ARENA_FUNCTION;   /* function prototypes */
+      case LUA_TUSERDATA: return MEMPOOL_ARENA_USERDATA;
+      case LUA_TTHREAD:   return MEMPOOL_ARENA_THREAD;
+      default:            return MEMPOOL_ARENA_OTHER;
+   }
+}
+
+/* 'osize' follows the lua_Alloc convention: it is only a size when 'ptr' is
+* not NULL (for a new object it carries the object type instead).
+*/
+void *luaReallocMem( CMemPool* pool, void * ptr, size_t osize, size_t nsize )
+{
+   if (NULL == ptr)
+   {
+      return pool->Alloc(nsize, ArenaOfType(osize));
+   }
+   return pool->Realloc(ptr, osize, nsize);
+}
+
+void *luaMemAlloc( void *ud, void *ptr, size_t osize, size_t nsize )
+{
+   CMemPool* pool = (CMemPool*)ud;
+   void* p;
+
+   if (0 == nsize)
+   {
+      if (NULL != ptr)
+      {
+         pool->Free(ptr, osize);
+      }
+      return NULL;
+   }
+   p = luaReallocMem(pool, ptr, osize, nsize);
+   if (NULL == p && pool->DrainFrees())   /* the queued frees may make room */
+   {
+      p = luaReallocMem(pool, ptr, osize, nsize);
+   }
+   return p;
+}
+
+void luaMemGCCycle( void *ud )
+{
+   CMemPool* pool = (CMemPool*)ud;
+
+   if (pool->AsyncFree())
+   {
+      pool->FlushFrees(true);   /* the free thread trims once it caught up */
+   }
+   else
+   {
+      pool->Trim();
+   }
+}
+
+int luaMemPressure( void *ud )
+{
+   return ((CMemPool*)ud)->Pressure();
+}
+
+void luaMemTrimAll( void *ud )
+{
+   ((CMemPool*)ud)->DrainFrees();
+   ((CMemPool*)ud)->Trim(true);
+}
+
+void luaMemFreeAsync( void *ud, void *ptr, size_t osize )
+{
+   ((CMemPool*)ud)->FreeLater(ptr, osize);
+}
+
+void luaMemFreeBatch( void *ud, void **ptrs, size_t *osizes, int n )
+{
+   ((CMemPool*)ud)->FreeMany(ptrs, osizes, n);
+}
+
+int luaSetMemAsyncFree( CMemPool* pool, int on )
+{
+   return pool->SetAsyncFree(0 != on) ? 1 : 0;
+}
+
+void luaDrainMem( CMemPool* pool )
+{
+   pool->DrainFrees();
+}
+
+void luaSetMemGrowth( CMemPool* pool, int policy, unsigned long step, size_t maxBytes )
+{
+   pool->SetGrowth(policy, step, maxBytes);
+}
+
+int luaMemAlignClass( CMemPool* pool, size_t size )
+{
+   return pool->AlignClass(size) ? 1 : 0;
+}
+
+size_t luaTrimMem( CMemPool* pool )
+{
+   return pool->Trim();
+}
+
+void luaSetMemMapping( CMemPool* pool, int flags )
+{
+   pool->SetMapping(flags);
+}
+
+size_t luaMemPrefault( CMemPool* pool, size_t bytes )
+{
+   return pool->Prefault(bytes);
+}
+
+size_t luaMemFootprint( CMemPool* pool )
+{
+   return pool->Footprint();
+}
+
+size_t luaMemArenaFootprint( CMemPool* pool, int arena )
+{
+   return (arena >= 0 && arena < MEMPOOL_ARENA_NUM) ? pool->ArenaFootprint(arena) : 0;
+}
+
+unsigned long long luaMemBytesCopied( CMemPool* pool )
+{
+   return pool->BytesCopied();
+}
+
+void luaMemStats( CMemPool* pool, MemPoolStats* stats )
+{
+   pool->Stats(stats);
+}
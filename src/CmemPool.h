@@ -1,48 +1,386 @@
-#ifndef __MEMPOOL_H__
-#define __MEMPOOL_H__
-
-#ifdef __cplusplus
-class CMemPool
-{
-private:
-   struct _Unit                            //The type of the node of linkedlist.
-   {
-      struct _Unit *pPrev, *pNext;
-   };
-
-   void*           m_pMemBlock;            //The address of memory pool.
-
-   //Manage all unit with two linkedlist.
-   struct _Unit*   m_pAllocatedMemBlock;   //Head pointer to Allocated linkedlist.
-   struct _Unit*   m_pFreeMemBlock;        //Head pointer to Free linkedlist.
-
-   unsigned long   m_ulUnitSize;           //Memory unit size. There are much unit in memory pool.
-   unsigned long   m_ulBlockSize;          //Memory pool size. Memory pool is make of memory unit.
-
-public:
-   CMemPool(unsigned long lUnitNum = 50, unsigned long lUnitSize = 1024);
-   ~CMemPool();
-
-   void*           Alloc(unsigned long ulSize, bool bUseMemPool = true);   //Allocate memory unit
-   void            Free( void* p );                                        //Free memory unit
-};
-#endif
-
-#ifdef __cplusplus
-extern "C" 
-{
-#endif
-
-   void luaCreateMem( unsigned int uiSize,  unsigned int unitSize );
-
-   void luaReleaseMem( void* p );
-
-   void luaDestroyMem( void );
-
-   void *luaReallocMem(void * ptr, size_t size);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif //__MEMPOOL_H__
\ No newline at end of file
+#ifndef __MEMPOOL_H__
+#define __MEMPOOL_H__
+
+#include <stddef.h>
+
+/* Growth policies of the pool (see CMemPool::SetGrowth). */
+#define MEMPOOL_GROW_LINEAR      0   /* add a fixed number of slabs */
+#define MEMPOOL_GROW_GEOMETRIC   1   /* double the slabs of the class, up to a step */
+
+/* Backing of the pool slabs (see CMemPool::SetMapping). With any flag set the
+* slabs are carved from 2 MB regions instead of being mapped one by one.
+*/
+#define MEMPOOL_MAP_SLABS        0   /* one mapping per slab */
+#define MEMPOOL_MAP_HUGEPAGE     1   /* regions on transparent huge pages */
+#define MEMPOOL_MAP_POPULATE     2   /* regions prefaulted when mapped */
+
+/* Arenas of the pool. A new Lua object goes to the arena of its type, so
+* objects of one type share slabs (see luaMemAlloc).
+*/
+#define MEMPOOL_ARENA_OTHER      0   /* untyped blocks: arrays, stacks, upvalues ... */
+#define MEMPOOL_ARENA_STRING     1
+#define MEMPOOL_ARENA_TABLE      2
+#define MEMPOOL_ARENA_FUNCTION   3   /* closures and prototypes */
+#define MEMPOOL_ARENA_USERDATA   4
+#define MEMPOOL_ARENA_THREAD     5
+#define MEMPOOL_ARENA_NUM        6
+
+#define MEMPOOL_MAX_CLASSES      64  /* size classes of one arena, at most */
+
+/* Snapshot of a pool (see luaMemStats). In a shared pool the units cached by
+* the threads count as in use, and the peak is sampled when a snapshot is
+* taken.
+*/
+typedef struct MemPoolClassStats
+{
+   unsigned long m_unitSize;
+   unsigned long m_slabNum;          /* slabs of the class, all arenas */
+   unsigned long m_usedNum;          /* units in use */
+   unsigned long m_freeListNum;      /* units in the free lists of the slabs */
+   unsigned long m_uncarvedNum;      /* units of the slabs never handed out yet */
+}MemPoolClassStats;
+
+typedef struct MemPoolStats
+{
+   size_t m_liveBytes;               /* bytes requested by the blocks in use */
+   size_t m_peakBytes;               /* most live bytes so far */
+   size_t m_footprint;               /* bytes taken from the system */
+   size_t m_spareBytes;              /* of which region slabs no class uses */
+   size_t m_peakFootprint;
+   size_t m_sysBytes;                /* bytes of the blocks too big for the pool */
+   size_t m_unitBytes;               /* bytes of the units in use */
+   double m_fragmentation;           /* share of m_unitBytes not requested, 0..1 */
+   unsigned long long m_failedNum;   /* allocations that returned NULL */
+   unsigned long long m_sysAllocNum; /* allocations served by the system */
+   size_t m_arenaBytes[MEMPOOL_ARENA_NUM];
+   unsigned long m_classNum;
+   MemPoolClassStats m_classes[MEMPOOL_MAX_CLASSES];
+}MemPoolStats;
+
+#ifdef __cplusplus
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+class CMemPool
+{
+private:
+   struct _SizeClass;
+   struct _Region;
+
+   struct _Unit                            //A free unit; allocated units have no header.
+   {
+      struct _Unit *pNext;                 //Next free unit of the slab.
+   };
+
+   struct _SysBlock                        //Header in front of every system block.
+   {
+      struct _SysBlock *pPrev, *pNext;
+      unsigned long   ulSize;              //Requested size of the block.
+      unsigned long   ulArena;             //Arena charged, also keeps the block 16 bytes aligned.
+   };
+
+   struct _Slab                            //Header at the start of every aligned slab.
+   {
+      struct _SizeClass* pClass;           //Size class the units of the slab belong to.
+      struct _Slab*   pPrev;               //Slabs of a class, the ones with free units first.
+      struct _Slab*   pNext;
+      struct _Unit*   pFreeMemBlock;       //Head pointer to Free linkedlist of the slab.
+      char*           pBump;               //First unit never handed out yet.
+      unsigned long   ulUsedNum;           //The number of unit currently allocated.
+      struct _Region* pRegion;             //Region the slab was carved from, NULL if mapped alone.
+   };
+
+   struct _Region                          //A large mapping carved into slabs.
+   {
+      char*           pBase;
+      unsigned long   ulSpareNum;          //Slabs of the region no class uses.
+      struct _Region* pNext;
+   };
+
+   struct _SizeClass                       //One segregated free list per unit size.
+   {
+      unsigned long   ulUnitSize;          //Memory unit size of this class.
+      unsigned long   ulStride;            //Distance between units, a multiple of 64 when aligned.
+      unsigned long   ulUnitNum;           //The number of unit in one slab of this class.
+      unsigned long   ulSlabNum;           //The number of slab owned by this class.
+      unsigned long   ulEmptyNum;          //The number of slab without allocated unit.
+      unsigned long   ulMagSize;           //Units held by a full magazine (concurrent mode).
+      int             iArena;              //Arena the class belongs to.
+      struct _Slab*   pSlabs;              //Slabs with free units.
+      struct _Slab*   pFullSlabs;          //Slabs without free unit.
+   };
+
+   enum { MIN_UNIT_SIZE = 16, MAX_CLASS_NUM = MEMPOOL_MAX_CLASSES, CACHE_LINE = 64 };
+   enum { SLAB_SHIFT = 16, SLAB_SIZE = 1 << SLAB_SHIFT, SLAB_HEADER_SIZE = CACHE_LINE };
+   enum { REGION_SIZE = 2 * 1024 * 1024, REGION_SLAB_NUM = REGION_SIZE / SLAB_SIZE };
+   enum { MAG_MAX_SIZE = 64, MAG_BYTES = 32 * 1024, DEPOT_SLOTS = 8, CACHE_SLOTS = 8 };
+   enum { FREE_BATCH_SIZE = 256 };
+
+   struct _Magazine                        //A stack of free units cached by one thread.
+   {
+      unsigned long   ulCount;
+      void*           pUnits[MAG_MAX_SIZE];
+   };
+
+   struct _FreeBatch                       //Blocks handed to the free thread together.
+   {
+      struct _FreeBatch* pNext;
+      unsigned long   ulCount;
+      struct
+      {
+         void*           p;
+         unsigned long   ulSize;
+      } aBlocks[FREE_BATCH_SIZE];
+   };
+
+   struct _ThreadCache                     //Magazines of one thread for this pool.
+   {
+      struct _Magazine* pLoaded[MEMPOOL_ARENA_NUM * MAX_CLASS_NUM];    //Units are taken from and given to it first.
+      struct _Magazine* pPrevious[MEMPOOL_ARENA_NUM * MAX_CLASS_NUM];  //Spare magazine, swapped with pLoaded.
+      struct _ThreadCache *pPrev, *pNext;           //All caches of the pool.
+      std::atomic<long long> llLiveBytes;           //Bytes counted by this thread, only it writes.
+      struct _FreeBatch* pFreeBatch;                //Blocks this thread queued, not handed over yet.
+   };
+
+   struct _Depot                           //Magazines shared by all threads, for one class.
+   {
+      std::atomic<struct _Magazine*> pFull[DEPOT_SLOTS];
+      std::atomic<struct _Magazine*> pEmpty[DEPOT_SLOTS];
+   };
+
+   struct _ThreadSlots                     //Caches of the running thread, one per pool used.
+   {
+      struct
+      {
+         CMemPool*          pPool;
+         unsigned long long ullId;
+         struct _ThreadCache* pCache;
+      } aSlot[CACHE_SLOTS];
+   };
+
+   struct _ThreadReaper                    //Gives the caches back when the thread exits.
+   {
+      bool bArmed;
+      ~_ThreadReaper();
+   };
+
+   class _Guard;                           //Holds m_Lock in concurrent mode only.
+   friend class _Guard;
+
+   struct _SizeClass m_Classes[MEMPOOL_ARENA_NUM * MAX_CLASS_NUM];   //The classes of each arena in turn.
+   unsigned long   m_ulClassNum;           //The number of size class in use, all arenas.
+   unsigned long   m_ulArenaClassNum;      //The number of size class of one arena.
+   unsigned long   m_ulMaxUnitSize;        //Largest size served from the pool.
+   unsigned char*  m_pClassOfSize;         //Size (in MIN_UNIT_SIZE steps) to class index.
+
+   int             m_iGrowPolicy;          //MEMPOOL_GROW_LINEAR or MEMPOOL_GROW_GEOMETRIC.
+   unsigned long   m_ulGrowStep;           //Slabs added (or at most added) on growth.
+   size_t          m_ulMaxBytes;           //Upper bound of slabs plus system blocks, 0 = none.
+   size_t          m_ulSlabBytes;          //Bytes of all slabs.
+   size_t          m_ulSysBytes;           //Bytes of all system blocks.
+   size_t          m_ulArenaBytes[MEMPOOL_ARENA_NUM];  //Bytes of slabs and system blocks per arena.
+   struct _SysBlock* m_pSysBlocks;         //Head pointer to system block linkedlist.
+   std::atomic<struct _SysBlock*> m_pSmallSysBlocks;  //System blocks a shrink left under m_ulMaxUnitSize.
+   int             m_iMapFlags;            //MEMPOOL_MAP_* of the slabs mapped from now on.
+   struct _Region* m_pRegions;             //Head pointer to region linkedlist.
+   struct _Slab*   m_pSpareSlabs;          //Region slabs no class uses.
+   size_t          m_ulSpareBytes;         //Their bytes.
+   size_t          m_ulPurgedBytes;        //Of which given back to the system (SlabPurge), still mapped.
+   size_t          m_ulReserveBytes;       //Footprint Trim does not go under, set by Prefault.
+
+   std::atomic<unsigned long long> m_ullBytesCopied;   //Bytes moved by Realloc between units.
+
+   long long       m_llLiveBytes;          //Live bytes counted under the lock (or by the only thread).
+   long long       m_llPeakBytes;
+   size_t          m_ulPeakFootprint;
+   unsigned long long m_ullSysAllocNum;    //Allocations served by SysAlloc.
+   std::atomic<unsigned long long> m_ullFailedNum;
+
+   bool            m_bConcurrent;          //Shared by several threads.
+   std::mutex      m_Lock;                 //Guards slabs and system blocks in concurrent mode.
+   struct _Depot*  m_pDepots;              //One depot per class in concurrent mode.
+   struct _ThreadCache* m_pCaches;         //Head pointer to thread cache linkedlist.
+   unsigned long long m_ullId;             //Tells a pool from an older one at the same address.
+   CMemPool*       m_pRegPrev;             //Live concurrent pools.
+   CMemPool*       m_pRegNext;
+
+   std::thread*    m_pFreeThread;          //Frees the queued blocks, NULL when frees are not deferred.
+   std::mutex      m_FreeLock;             //Guards the free queue and the flags below.
+   std::condition_variable m_FreeWake;     //Work (or stop) for the free thread.
+   std::condition_variable m_FreeIdle;     //The free thread ran out of work.
+   struct _FreeBatch* m_pFreeQueue;        //Batches handed over.
+   struct _FreeBatch* m_pFreeSpare;        //Empty batches kept for reuse.
+   bool            m_bFreeBusy;            //The free thread works outside the lock.
+   bool            m_bFreeTrim;            //Trim once the queue is empty.
+   bool            m_bFreeStop;
+
+   static thread_local struct _ThreadSlots t_Slots;    //Trivial, so reaching it costs nothing.
+   static thread_local struct _ThreadReaper t_Reaper;
+
+   static unsigned long NextClassSize(unsigned long ulSize);
+   struct _SizeClass* ClassOf(unsigned long ulSize, int iArena)
+   {
+      return &m_Classes[iArena * m_ulArenaClassNum + m_pClassOfSize[(ulSize + MIN_UNIT_SIZE - 1) / MIN_UNIT_SIZE]];
+   }
+   static struct _Slab* SlabOf(void* p) { return (struct _Slab *)((size_t)p & ~(size_t)(SLAB_SIZE - 1)); }
+   static void     SlabLink(struct _Slab **ppList, struct _Slab *pSlab);
+   static void     SlabUnlink(struct _Slab **ppList, struct _Slab *pSlab);
+   bool            AddSlab(struct _SizeClass *pClass);
+   bool            AddRegion(bool bPopulate);
+   void            ReleaseRegion(struct _Region *pRegion);
+   bool            Grow(struct _SizeClass *pClass);
+   void            ReleaseSlab(struct _Slab *pSlab);
+   void*           SlabAlloc(struct _SizeClass *pClass);
+   void            SlabFree(void* p, struct _SizeClass *pClass);
+   void            SlabFreeRun(struct _Slab *pSlab, struct _Unit *pFirst, struct _Unit *pLast, unsigned long ulNum);
+   void*           SysAlloc(unsigned long ulSize, int iArena);
+   void            SysFree(void* p);
+   void            SysLink(struct _SysBlock *pBlock);
+   void            SysUnlink(struct _SysBlock *pBlock);
+   void            SysKeepSmall(struct _SysBlock *pBlock);
+   bool            IsSmallSys(void* p);
+   void*           SysRealloc(void* p, unsigned long ulOldSize, unsigned long ulNewSize);
+   void            AddLive(long long llDelta)
+   {
+      m_llLiveBytes += llDelta;
+      if(m_llLiveBytes > m_llPeakBytes)
+      {
+         m_llPeakBytes = m_llLiveBytes;
+      }
+   }
+   void            CountLive(long long llDelta);
+   void            NoteFootprint()
+   {
+      if(Footprint() > m_ulPeakFootprint)
+      {
+         m_ulPeakFootprint = Footprint();
+      }
+   }
+
+   struct _ThreadCache* ThreadCache();
+   void*           CacheAlloc(struct _SizeClass *pClass, unsigned long ulSize);
+   void*           CacheRefill(struct _ThreadCache *pCache, struct _SizeClass *pClass);
+   void            CacheFree(void* p, struct _SizeClass *pClass, unsigned long ulSize);
+   void            CacheSpill(struct _ThreadCache *pCache, void* p, struct _SizeClass *pClass);
+   void            FlushMagazine(struct _Magazine *pMag, struct _SizeClass *pClass);
+   void            ReleaseCache(struct _ThreadCache *pCache);
+   static bool     DepotPush(std::atomic<struct _Magazine*> *pSlots, struct _Magazine *pMag);
+   static struct _Magazine* DepotPop(std::atomic<struct _Magazine*> *pSlots);
+   static bool     IsAlive(CMemPool* pPool, unsigned long long ullId);
+   struct _FreeBatch* TakeBatch();
+   void            QueueBatch(struct _FreeBatch *pBatch, bool bTrim);
+   void            FreeBatch(struct _FreeBatch *pBatch);
+   void            FreeThreadMain();
+
+public:
+   CMemPool(unsigned long lUnitNum = 50, unsigned long lUnitSize = 1024, bool bConcurrent = false);
+   ~CMemPool();
+
+   void*           Alloc(unsigned long ulSize, int iArena = MEMPOOL_ARENA_OTHER);   //Allocate memory unit
+   void            Free( void* p, unsigned long ulSize );                  //Free memory unit
+   void            FreeMany(void** ppBlocks, size_t* pSizes, int iNum);    //Free several at once
+   void*           Realloc(void* p, unsigned long ulOldSize, unsigned long ulNewSize,
+                           int iArena = MEMPOOL_ARENA_OTHER);              //Resize memory unit
+   unsigned long   UnitSize( void* p, unsigned long ulSize );              //Usable size of a unit
+   bool            AlignClass(unsigned long ulSize);                       //Cache-line align a class
+   void            SetGrowth(int iPolicy, unsigned long ulStep, size_t ulMaxBytes); //Growth policy
+   size_t          Trim(bool bAll = false);                                //Release empty slabs
+   void            SetMapping(int iFlags);                                 //Back slabs by regions
+   size_t          Prefault(size_t ulBytes);                               //Warm the pool up
+   int             Pressure();                                             //How full, for the collector        
+   size_t          Footprint() const { return m_ulSlabBytes + m_ulSpareBytes - m_ulPurgedBytes + m_ulSysBytes; } //Bytes taken from system
+   size_t          ArenaFootprint(int iArena) const { return m_ulArenaBytes[iArena]; } //The same for one arena
+   unsigned long long BytesCopied() const { return m_ullBytesCopied.load(std::memory_order_relaxed); }
+   void            Stats(MemPoolStats* pStats);                            //Take a snapshot
+   bool            SetAsyncFree(bool bOn);                                 //Free on a helper thread
+   bool            AsyncFree() const { return NULL != m_pFreeThread; }     //Whether frees are deferred
+   void            FreeLater(void* p, unsigned long ulSize);               //Free on the helper thread
+   void            FlushFrees(bool bTrim);                                 //Hand over the pending frees
+   bool            DrainFrees();                                           //Wait until they are done
+};
+#else
+typedef struct CMemPool CMemPool;
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+   /* Every lua_State gets its own pool: create it, give it as the 'ud' of
+   * lua_newstate(luaMemAlloc, pool) and destroy it after lua_close. Destroying
+   * a pool frees all its memory at once, even for a state that was not closed
+   * (no finalizer runs then).
+   * Units carry no header, so a block must be freed and resized with the size
+   * it was requested with (the 'osize' Lua passes to its lua_Alloc).
+   */
+   CMemPool* luaCreateMem( unsigned int uiSize,  unsigned int unitSize );
+
+   /* A pool that several threads (each running its own lua_State) may use at
+   * the same time. Threads allocate from private per-class magazines.
+   */
+   CMemPool* luaCreateSharedMem( unsigned int uiSize,  unsigned int unitSize );
+
+   void luaDestroyMem( CMemPool* pool );
+
+   void luaReleaseMem( CMemPool* pool, void* p, size_t osize );
+
+   void *luaReallocMem( CMemPool* pool, void * ptr, size_t osize, size_t nsize );
+
+   /* lua_Alloc, ud is the pool. For a new object ('ptr' NULL) 'osize' is the
+   * Lua type of the object, which picks the arena.
+   */
+   void *luaMemAlloc( void *ud, void *ptr, size_t osize, size_t nsize );
+
+   void luaMemGCCycle( void *ud );                                         /* lua_AllocHooks.gccycle */
+
+   int luaMemPressure( void *ud );                                         /* lua_AllocHooks.pressure */
+
+   void luaMemTrimAll( void *ud );                                         /* lua_AllocHooks.trim */
+
+   void luaMemFreeAsync( void *ud, void *ptr, size_t osize );              /* lua_AllocHooks.freeasync */
+
+   void luaMemFreeBatch( void *ud, void **ptrs, size_t *osizes, int n );   /* lua_AllocHooks.freebatch */
+
+   /* Blocks the collector frees while sweeping (luaMemFreeAsync) are queued
+   * and freed in batches by a helper thread, which also trims the pool at the
+   * end of each cycle. Only for a shared pool, whose units any thread may
+   * free; returns 0 otherwise. Switch it while no thread uses the pool.
+   * luaDrainMem waits until every queued block is freed.
+   */
+   int luaSetMemAsyncFree( CMemPool* pool, int on );
+
+   void luaDrainMem( CMemPool* pool );
+
+   void luaSetMemGrowth( CMemPool* pool, int policy, unsigned long step, size_t maxBytes );
+
+   /* Units of the class holding 'size' bytes start on a cache line (e.g. for
+   * sizeof(Table) or sizeof(CallInfo)). Only before the class has any slab.
+   */
+   int luaMemAlignClass( CMemPool* pool, size_t size );
+
+   size_t luaTrimMem( CMemPool* pool );
+
+   /* Carve the slabs from 2 MB regions on huge pages and/or prefaulted
+   * (MEMPOOL_MAP_*), and map 'bytes' of them up front so the first request
+   * of a warm worker takes no page fault. Prefault returns the footprint.
+   */
+   void luaSetMemMapping( CMemPool* pool, int flags );
+
+   size_t luaMemPrefault( CMemPool* pool, size_t bytes );
+
+   size_t luaMemFootprint( CMemPool* pool );
+
+   size_t luaMemArenaFootprint( CMemPool* pool, int arena );   /* MEMPOOL_ARENA_* */
+
+   unsigned long long luaMemBytesCopied( CMemPool* pool );
+
+   void luaMemStats( CMemPool* pool, MemPoolStats* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__MEMPOOL_H__
@@ -0,0 +1,96 @@
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "allocadapter.h"
+
+/* The backend of states that do not name one; make ALLOC=... sets it */
+#ifndef LUA_ALLOCATOR
+#define LUA_ALLOCATOR   "pool"
+#endif
+
+void *luaSysAlloc( void *ud, void *ptr, size_t osize, size_t nsize )
+{
+   (void) ud; (void) osize;
+   if ( nsize == 0 )
+   {
+      free( ptr );
+      return NULL;
+   }
+   return realloc( ptr, nsize );
+}
+
+static void* pool_create( void ) { return luaCreateMem( 0, 2048 ); }
+static void* shared_create( void ) { return luaCreateSharedMem( 0, 2048 ); }
+static void pool_destroy( void* ud ) { luaDestroyMem( (CMemPool*) ud ); }
+static void* buffer_create( void ) { return luaCreateBufferAllocator( 0, 0 ); }
+static void buffer_destroy( void* ud ) { luaReleaseBufferAllocator( (LuaBufferAllocator*) ud ); }
+static void* malloc_create( void ) { return NULL; }
+static void malloc_destroy( void* ud ) { (void) ud; }
+static void* arena_create( void ) { return luaCreateArena( 0 ); }
+static void arena_destroy( void* ud ) { luaDestroyArena( (LuaArena*) ud ); }
+static void* debug_create( void ) { return luaCreateDebugAlloc(); }
+static void debug_destroy( void* ud ) { luaDestroyDebugAlloc( (LuaDebugAlloc*) ud ); }
+
+#define shared_destroy  pool_destroy
+
+static const lua_AllocHooks g_poolHooks = { luaMemGCCycle, NULL, luaMemPressure, luaMemTrimAll, NULL, luaMemFreeBatch };  /* trim, pace the GC, batch frees */
+static const lua_AllocHooks g_sharedHooks = { luaMemGCCycle, NULL, luaMemPressure, luaMemTrimAll, luaMemFreeAsync, NULL };  /* and luaSetMemAsyncFree */
+static const lua_AllocHooks g_arenaHooks = { NULL, luaArenaFreeAll, NULL, NULL, NULL, NULL };                  /* lua_close empties the arena */
+
+#if defined( __GLIBC__ )
+#include <malloc.h>
+static void malloc_trim_all( void* ud ) { (void) ud; malloc_trim( 0 ); }
+static const lua_AllocHooks g_mallocHooks = { NULL, NULL, NULL, malloc_trim_all, NULL, NULL };                /* give the free heap back */
+#define malloc_hooks    (&g_mallocHooks)
+#else
+#define malloc_hooks    NULL
+#endif
+
+#define pool_hooks      (&g_poolHooks)
+#define shared_hooks    (&g_sharedHooks)
+#define buffer_hooks    NULL
+#define arena_hooks     (&g_arenaHooks)
+#define debug_hooks     NULL
+
+#define LUA_ALLOCATOR_ENTRY(id, name, alloc) \
+   { LUA_ALLOCATOR_##id, name, id##_create, id##_destroy, alloc, id##_hooks },
+
+static const LuaAllocator g_allocators[LUA_ALLOCATOR_NUM] =
+{
+   LUA_ALLOCATORS(LUA_ALLOCATOR_ENTRY)
+};
+
+const LuaAllocator* luaFindAllocator( const char* name )
+{
+   int index;
+
+   if ( name == NULL || *name == '\0' )
+   {
+      name = LUA_ALLOCATOR;
+   }
+   for ( index = 0; index < LUA_ALLOCATOR_NUM; ++index )
+   {
+      if ( strcmp( g_allocators[index].m_name, name ) == 0 )
+      {
+         return &g_allocators[index];
+      }
+   }
+   return NULL;
+}
+
+const LuaAllocator* luaGetAllocator( int id )
+{
+   return ( id >= 0 && id < LUA_ALLOCATOR_NUM ) ? &g_allocators[id] : NULL;
+}
+
+lua_State* luaNewStateOn( const LuaAllocator* allocator, void* ud )
+{
+   lua_State* L = lua_newstate( allocator->m_alloc, ud );
+
+   if ( L != NULL && allocator->m_pHooks != NULL )
+   {
+      lua_setallochooks( L, allocator->m_pHooks );
+   }
+   return L;
+}
@@ -0,0 +1,64 @@
+#ifndef ALLOC_ADAPTER_H_
+#define ALLOC_ADAPTER_H_
+#include "lua.h"
+#include "CmemPool.h"
+#include "arenaalloc.h"
+#include "bufferalloc.h"
+#include "debugalloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+   /* Every allocator a lua_State can run on, behind one interface. A host
+   * picks one by name when it creates a state, or takes the build default
+   * (make ALLOC=buffer):
+   *
+   *    const LuaAllocator* a = luaFindAllocator(getenv("LUA_ALLOCATOR"));
+   *    void* ud = a->m_create();
+   *    L = luaNewStateOn(a, ud);
+   *    ...
+   *    lua_close(L);
+   *    a->m_destroy(ud);
+   *
+   * The list below is an X-macro, X(id, name, alloc), so a host that wraps
+   * the allocator (to count or trace) can generate one wrapper per backend,
+   * each calling its lua_Alloc directly instead of through the table:
+   *
+   *    #define WRAP(id, name, alloc) static void* wrap_##id(...) { ... alloc(...) ... }
+   *    LUA_ALLOCATORS(WRAP)
+   */
+#define LUA_ALLOCATORS(X) \
+   X( pool,   "pool",   luaMemAlloc ) \
+   X( shared, "shared", luaMemAlloc ) \
+   X( buffer, "buffer", luaBufferAlloc ) \
+   X( malloc, "malloc", luaSysAlloc ) \
+   X( arena,  "arena",  luaArenaAlloc ) \
+   X( debug,  "debug",  luaDebugAlloc )
+
+#define LUA_ALLOCATOR_ID(id, name, alloc)    LUA_ALLOCATOR_##id,
+   enum { LUA_ALLOCATORS(LUA_ALLOCATOR_ID) LUA_ALLOCATOR_NUM };
+#undef LUA_ALLOCATOR_ID
+
+   typedef struct LuaAllocator
+   {
+      int m_id;                           /* LUA_ALLOCATOR_* */
+      const char* m_name;
+      void* (*m_create)( void );          /* the 'ud' of the state */
+      void (*m_destroy)( void* ud );      /* after lua_close */
+      lua_Alloc m_alloc;
+      const lua_AllocHooks* m_pHooks;     /* NULL when the backend needs none */
+   }LuaAllocator;
+
+   const LuaAllocator* luaFindAllocator( const char* name );   /* NULL for the build default; NULL if unknown */
+   const LuaAllocator* luaGetAllocator( int id );               /* LUA_ALLOCATOR_* */
+
+   lua_State* luaNewStateOn( const LuaAllocator* allocator, void* ud );   /* lua_newstate with the backend hooks */
+
+   void *luaSysAlloc( void *ud, void *ptr, size_t osize, size_t nsize );   /* lua_Alloc on malloc, ud unused */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //!ALLOC_ADAPTER_H_
@@ -0,0 +1,278 @@
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "allocadapter.h"
+#include "alloctrace.h"
+
+/*
+* Offline allocator comparison. "record" runs a Lua script and logs the
+* calls its lua_Alloc receives; "replay" feeds such a trace to every
+* allocator of allocadapter.h, each in its own process so the peak RSS is its own.
+*
+*    allocreplay record work.trc script.lua
+*    allocreplay replay work.trc [allocator]
+*/
+
+typedef struct Trace
+{
+   AllocTraceHeader m_header;
+   AllocTraceRecord* m_records;
+}Trace;
+
+static double now_ns (void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long peak_rss_kb (void)
+{
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_maxrss;
+}
+
+/* ---- record ---- */
+
+typedef struct RecordContext
+{
+   LuaAllocTrace* m_pTrace;
+}RecordContext;
+
+static void *record_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
+{
+   RecordContext* pContext = (RecordContext*)ud;
+   void* result = luaSysAlloc(NULL, ptr, osize, nsize);
+
+   luaTraceAlloc(pContext->m_pTrace, ptr, osize, nsize, result);
+   return result;
+}
+
+static int record (const char* tracePath, const char* script)
+{
+   RecordContext context;
+   lua_State* L;
+   int status;
+
+   context.m_pTrace = luaOpenAllocTrace(tracePath);
+   if (context.m_pTrace == NULL)
+   {
+      fprintf(stderr, "cannot open %s\n", tracePath);
+      return 1;
+   }
+   L = lua_newstate(record_alloc, &context);
+   luaL_openlibs(L);
+   status = luaL_dofile(L, script);
+   if (status != LUA_OK)
+   {
+      fprintf(stderr, "%s\n", lua_tostring(L, -1));
+   }
+   lua_close(L);
+   luaCloseAllocTrace(context.m_pTrace);
+   return status != LUA_OK;
+}
+
+/* ---- replay ---- */
+
+static int load_trace (const char* path, Trace* pTrace)
+{
+   FILE* file = fopen(path, "rb");
+   int ok = 0;
+
+   if (file == NULL)
+   {
+      return 0;
+   }
+   if (fread(&pTrace->m_header, sizeof(pTrace->m_header), 1, file) == 1 &&
+       pTrace->m_header.m_magic == ALLOC_TRACE_MAGIC &&
+       pTrace->m_header.m_version == ALLOC_TRACE_VERSION)
+   {
+      pTrace->m_records = (AllocTraceRecord*)malloc(
+         (size_t)pTrace->m_header.m_recordNum * sizeof(AllocTraceRecord) + 1);
+      ok = pTrace->m_records != NULL &&
+           fread(pTrace->m_records, sizeof(AllocTraceRecord), pTrace->m_header.m_recordNum, file)
+              == pTrace->m_header.m_recordNum;
+   }
+   fclose(file);
+   return ok;
+}
+
+typedef struct ReplayResult
+{
+   double m_ns;                 /* whole replay, untimed ops */
+   size_t m_peakLive;
+   unsigned long m_failed;
+}ReplayResult;
+
+/*
+* Runs the whole trace once. With 'latencies' every call is timed (ns).
+* Blocks are written like Lua would, so their pages count in the RSS.
+*/
+static void replay (const LuaAllocator* a, const Trace* pTrace, void** blocks,
+                    uint32_t* sizes, uint32_t* latencies, ReplayResult* pResult)
+{
+   void* ud = a->m_create();
+   size_t live = 0;
+   double start = now_ns();
+   uint32_t i;
+
+   memset(blocks, 0, pTrace->m_header.m_idNum * sizeof(void*));
+   memset(pResult, 0, sizeof(*pResult));
+
+   for (i = 0; i < pTrace->m_header.m_recordNum; i++)
+   {
+      const AllocTraceRecord* r = &pTrace->m_records[i];
+      void* p = blocks[r->m_id];
+      size_t osize = (p != NULL) ? sizes[r->m_id] : 0;
+      double t0 = 0;
+      void* result;
+
+      if (latencies != NULL)
+      {
+         t0 = now_ns();
+      }
+      result = a->m_alloc(ud, p, (p != NULL) ? osize : r->m_osize, r->m_nsize);
+      if (latencies != NULL)
+      {
+         latencies[i] = (uint32_t)(now_ns() - t0);
+      }
+
+      if (result == NULL && r->m_nsize != 0)
+      {
+         pResult->m_failed++;
+         continue;
+      }
+      if (r->m_nsize > osize)
+      {
+         memset((char*)result + osize, 0, r->m_nsize - osize);
+      }
+      blocks[r->m_id] = result;
+      sizes[r->m_id] = r->m_nsize;
+      live = live - osize + r->m_nsize;
+      if (live > pResult->m_peakLive)
+      {
+         pResult->m_peakLive = live;
+      }
+   }
+   pResult->m_ns = now_ns() - start;
+
+   for (i = 0; i < pTrace->m_header.m_idNum; i++)
+   {
+      if (blocks[i] != NULL)
+      {
+         a->m_alloc(ud, blocks[i], sizes[i], 0);
+      }
+   }
+   a->m_destroy(ud);
+}
+
+static int compare_u32 (const void* a, const void* b)
+{
+   uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+   return (x > y) - (x < y);
+}
+
+static void replay_one (const LuaAllocator* a, const Trace* pTrace)
+{
+   uint32_t n = pTrace->m_header.m_recordNum;
+   void** blocks = (void**)malloc(pTrace->m_header.m_idNum * sizeof(void*) + 1);
+   uint32_t* sizes = (uint32_t*)malloc(pTrace->m_header.m_idNum * sizeof(uint32_t) + 1);
+   uint32_t* latencies = (uint32_t*)malloc(n * sizeof(uint32_t) + 1);
+   ReplayResult result, timed;
+   long baseRss, peakRss;
+   double frag;
+
+   if (blocks == NULL || sizes == NULL || latencies == NULL)
+   {
+      fprintf(stderr, "%s: out of memory\n", a->m_name);
+      return;
+   }
+   memset(latencies, 0, n * sizeof(uint32_t));
+   memset(sizes, 0, pTrace->m_header.m_idNum * sizeof(uint32_t));
+   baseRss = peak_rss_kb();
+
+   replay(a, pTrace, blocks, sizes, NULL, &result);
+   peakRss = peak_rss_kb();
+   replay(a, pTrace, blocks, sizes, latencies, &timed);
+   qsort(latencies, n, sizeof(uint32_t), compare_u32);
+
+   /* share of the memory grown for the replay that did not hold live data */
+   frag = 0.0;
+   if (peakRss > baseRss && (double)(peakRss - baseRss) * 1024 > result.m_peakLive)
+   {
+      frag = 100.0 * (1.0 - result.m_peakLive / ((double)(peakRss - baseRss) * 1024));
+   }
+
+   printf("%-12s %10.2f %12ld %8.1f %8u %8u %8u %8lu\n", a->m_name,
+      n / (result.m_ns / 1e9) / 1e6, peakRss - baseRss, frag,
+      latencies[n / 2], latencies[(size_t)n * 99 / 100], latencies[(size_t)n * 999 / 1000],
+      result.m_failed);
+   fflush(stdout);
+
+   free(latencies);
+   free(sizes);
+   free(blocks);
+}
+
+static int replay_all (const char* tracePath, const char* which)
+{
+   int id;
+   Trace trace;
+
+   if (!load_trace(tracePath, &trace) || trace.m_header.m_recordNum == 0)
+   {
+      fprintf(stderr, "%s: not a trace\n", tracePath);
+      return 1;
+   }
+   printf("%u calls, %u blocks\n", trace.m_header.m_recordNum, trace.m_header.m_idNum);
+   printf("%-12s %10s %12s %8s %8s %8s %8s %8s\n",
+      "allocator", "Mops/s", "peak RSS KB", "frag %", "p50 ns", "p99 ns", "p99.9 ns", "failed");
+   fflush(stdout);
+
+   for (id = 0; id < LUA_ALLOCATOR_NUM; id++)
+   {
+      const LuaAllocator* a = luaGetAllocator(id);
+      pid_t pid;
+
+      if (which != NULL && strcmp(which, a->m_name) != 0)
+      {
+         continue;
+      }
+      pid = fork();
+      if (pid == 0)
+      {
+         replay_one(a, &trace);
+         exit(0);
+      }
+      if (pid > 0)
+      {
+         waitpid(pid, NULL, 0);
+      }
+   }
+   free(trace.m_records);
+   return 0;
+}
+
+int main (int argc, char** argv)
+{
+   if (argc == 4 && strcmp(argv[1], "record") == 0)
+   {
+      return record(argv[2], argv[3]);
+   }
+   if ((argc == 3 || argc == 4) && strcmp(argv[1], "replay") == 0)
+   {
+      return replay_all(argv[2], argc == 4 ? argv[3] : NULL);
+   }
+   fprintf(stderr, "usage: %s record trace script.lua\n"
+                   "       %s replay trace [allocator]\n", argv[0], argv[0]);
+   return 1;
+}
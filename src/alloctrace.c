@@ -0,0 +1,214 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "luaconf.h"
+#include "alloctrace.h"
+
+#define TRACE_BUFFER_SIZE  (1 << 20)
+
+/* Live blocks: open addressing with linear probing, keyed by address. */
+typedef struct TraceSlot
+{
+   void* m_ptr;
+   uint32_t m_id;
+}TraceSlot;
+
+struct LuaAllocTrace
+{
+   FILE* m_file;
+   TraceSlot* m_slots;
+   size_t m_slotNum;             /* a power of 2 */
+   size_t m_liveNum;
+   uint32_t m_nextId;
+   uint32_t m_recordNum;
+   double m_start;               /* microseconds, see trace_clockus */
+};
+
+/* A monotonic clock in microseconds; without POSIX, processor time. */
+#if defined( LUA_USE_POSIX )
+static double trace_clockus( void )
+{
+   struct timespec ts;
+
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return (double) ts.tv_sec * 1e6 + (double) ts.tv_nsec / 1e3;
+}
+#else
+static double trace_clockus( void )
+{
+   return (double) clock() * ( 1e6 / CLOCKS_PER_SEC );
+}
+#endif
+
+static size_t trace_hash( const LuaAllocTrace* trace, void* ptr )
+{
+   return (size_t)( ( (uint64_t)(size_t)ptr >> 4 ) * 0x9E3779B97F4A7C15ULL >> 20 ) & ( trace->m_slotNum - 1 );
+}
+
+static size_t trace_find( const LuaAllocTrace* trace, void* ptr )
+{
+   size_t i = trace_hash( trace, ptr );
+
+   while ( trace->m_slots[i].m_ptr != NULL && trace->m_slots[i].m_ptr != ptr )
+   {
+      i = ( i + 1 ) & ( trace->m_slotNum - 1 );
+   }
+   return i;
+}
+
+static int trace_insert( LuaAllocTrace* trace, void* ptr, uint32_t id );
+
+static int trace_grow( LuaAllocTrace* trace )
+{
+   TraceSlot* oldSlots = trace->m_slots;
+   size_t oldNum = trace->m_slotNum;
+   size_t i;
+
+   trace->m_slots = (TraceSlot*) calloc( oldNum * 2, sizeof( TraceSlot ) );
+   if ( trace->m_slots == NULL )
+   {
+      trace->m_slots = oldSlots;
+      return 0;
+   }
+   trace->m_slotNum = oldNum * 2;
+   trace->m_liveNum = 0;
+   for ( i = 0; i < oldNum; i++ )
+   {
+      if ( oldSlots[i].m_ptr != NULL )
+      {
+         trace_insert( trace, oldSlots[i].m_ptr, oldSlots[i].m_id );
+      }
+   }
+   free( oldSlots );
+   return 1;
+}
+
+static int trace_insert( LuaAllocTrace* trace, void* ptr, uint32_t id )
+{
+   size_t i;
+
+   if ( 2 * ( trace->m_liveNum + 1 ) > trace->m_slotNum && !trace_grow( trace ) )
+   {
+      return 0;
+   }
+   i = trace_find( trace, ptr );
+   if ( trace->m_slots[i].m_ptr == NULL )
+   {
+      trace->m_liveNum++;
+   }
+   trace->m_slots[i].m_ptr = ptr;
+   trace->m_slots[i].m_id = id;
+   return 1;
+}
+
+/* Backward shift deletion, so no tombstone is needed. */
+static void trace_remove( LuaAllocTrace* trace, size_t i )
+{
+   size_t mask = trace->m_slotNum - 1;
+   size_t j = i;
+
+   for ( ;; )
+   {
+      size_t home;
+
+      j = ( j + 1 ) & mask;
+      if ( trace->m_slots[j].m_ptr == NULL )
+      {
+         break;
+      }
+      home = trace_hash( trace, trace->m_slots[j].m_ptr );
+      /* move slot j back to i unless its home lies cyclically in (i, j] */
+      if ( ( j > i ) ? ( home <= i || home > j ) : ( home <= i && home > j ) )
+      {
+         trace->m_slots[i] = trace->m_slots[j];
+         i = j;
+      }
+   }
+   trace->m_slots[i].m_ptr = NULL;
+   trace->m_liveNum--;
+}
+
+LuaAllocTrace* luaOpenAllocTrace( const char* path )
+{
+   AllocTraceHeader header = { ALLOC_TRACE_MAGIC, ALLOC_TRACE_VERSION, 0, 0 };
+   LuaAllocTrace* trace = (LuaAllocTrace*) calloc( 1, sizeof( LuaAllocTrace ) );
+
+   if ( trace == NULL )
+   {
+      return NULL;
+   }
+   trace->m_slotNum = 1024;
+   trace->m_slots = (TraceSlot*) calloc( trace->m_slotNum, sizeof( TraceSlot ) );
+   trace->m_file = fopen( path, "wb" );
+   if ( trace->m_slots == NULL || trace->m_file == NULL ||
+        fwrite( &header, sizeof( header ), 1, trace->m_file ) != 1 )
+   {
+      if ( trace->m_file != NULL )
+      {
+         fclose( trace->m_file );
+      }
+      free( trace->m_slots );
+      free( trace );
+      return NULL;
+   }
+   setvbuf( trace->m_file, NULL, _IOFBF, TRACE_BUFFER_SIZE );
+   trace->m_start = trace_clockus();
+   return trace;
+}
+
+void luaCloseAllocTrace( LuaAllocTrace* trace )
+{
+   AllocTraceHeader header = { ALLOC_TRACE_MAGIC, ALLOC_TRACE_VERSION, 0, 0 };
+
+   header.m_idNum = trace->m_nextId;
+   header.m_recordNum = trace->m_recordNum;
+   fseek( trace->m_file, 0, SEEK_SET );
+   fwrite( &header, sizeof( header ), 1, trace->m_file );
+   fclose( trace->m_file );
+   free( trace->m_slots );
+   free( trace );
+}
+
+void luaTraceAlloc( LuaAllocTrace* trace, void* ptr, size_t osize, size_t nsize, void* result )
+{
+   AllocTraceRecord record;
+
+   if ( nsize != 0 && result == NULL )
+   {
+      return;                       /* failed, nothing changed */
+   }
+   if ( ptr == NULL )
+   {
+      if ( nsize == 0 || !trace_insert( trace, result, trace->m_nextId ) )
+      {
+         return;
+      }
+      record.m_id = trace->m_nextId++;
+   }
+   else
+   {
+      size_t i = trace_find( trace, ptr );
+
+      if ( trace->m_slots[i].m_ptr == NULL )
+      {
+         return;                    /* allocated before the trace was opened */
+      }
+      record.m_id = trace->m_slots[i].m_id;
+      if ( nsize == 0 || result != ptr )
+      {
+         trace_remove( trace, i );
+         if ( nsize != 0 )
+         {
+            trace_insert( trace, result, record.m_id );
+         }
+      }
+   }
+   record.m_osize = (uint32_t) osize;
+   record.m_nsize = (uint32_t) nsize;
+   record.m_time = (uint32_t)( trace_clockus() - trace->m_start );
+   fwrite( &record, sizeof( record ), 1, trace->m_file );
+   trace->m_recordNum++;
+}
@@ -0,0 +1,51 @@
+#ifndef ALLOC_TRACE_H_
+#define ALLOC_TRACE_H_
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+   /* A binary log of the calls a lua_Alloc receives, to be replayed offline
+   * against any allocator (see allocreplay.c). Pointers are replaced by ids,
+   * the same for a block across its resizes.
+   *
+   * File layout: one AllocTraceHeader, then AllocTraceRecord's. A record
+   * with no live block for its id is an allocation ('osize' being the type
+   * hint of lua_Alloc), one with 'nsize' 0 a free, any other a resize.
+   */
+#define ALLOC_TRACE_MAGIC     0x4352544CU   /* "LTRC" */
+#define ALLOC_TRACE_VERSION   1
+
+   typedef struct AllocTraceHeader
+   {
+      uint32_t m_magic;
+      uint32_t m_version;
+      uint32_t m_idNum;          /* ids are 0 .. m_idNum - 1 */
+      uint32_t m_recordNum;
+   }AllocTraceHeader;
+
+   typedef struct AllocTraceRecord
+   {
+      uint32_t m_id;
+      uint32_t m_osize;
+      uint32_t m_nsize;
+      uint32_t m_time;           /* microseconds since the trace was opened */
+   }AllocTraceRecord;
+
+   typedef struct LuaAllocTrace LuaAllocTrace;
+
+   LuaAllocTrace* luaOpenAllocTrace( const char* path );
+   void luaCloseAllocTrace( LuaAllocTrace* trace );
+
+   /* Logs one lua_Alloc call, once the allocator returned 'result'. Failed
+   * calls are not logged.
+   */
+   void luaTraceAlloc( LuaAllocTrace* trace, void* ptr, size_t osize, size_t nsize, void* result );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //!ALLOC_TRACE_H_
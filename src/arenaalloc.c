@@ -0,0 +1,184 @@
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "arenaalloc.h"
+
+#define ARENA_CHUNK_SIZE   (256 * 1024)
+#define ARENA_ALIGN        16
+#define ARENA_ROUND(s)     (((s) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct ArenaChunk
+{
+   struct ArenaChunk* m_pNext;
+   size_t m_size;                /* usable bytes, after the header */
+}ArenaChunk;
+
+#define CHUNK_HEADER       ARENA_ROUND(sizeof(ArenaChunk))
+#define CHUNK_DATA(c)      ((char*)(c) + CHUNK_HEADER)
+
+struct LuaArena
+{
+   ArenaChunk* m_pChunks;        /* all chunks, in the order they are filled */
+   ArenaChunk* m_pCurrent;       /* chunk being filled, NULL after a reset */
+   char* m_pTop;                 /* next free byte of the current chunk */
+   char* m_pEnd;                 /* end of the current chunk */
+   char* m_pLast;                /* last block handed out, which can still move the top */
+   size_t m_chunkSize;
+   size_t m_used;
+   size_t m_highWater;
+   size_t m_reserved;
+};
+
+/* Move to the next kept chunk big enough for 'size' bytes, or add one after
+** the current chunk. Chunks skipped over stay unused until the next reset.
+*/
+static int arena_nextchunk( LuaArena* arena, size_t size )
+{
+   ArenaChunk* chunk = ( arena->m_pCurrent != NULL ) ? arena->m_pCurrent->m_pNext : arena->m_pChunks;
+
+   while ( chunk != NULL && chunk->m_size < size )
+   {
+      chunk = chunk->m_pNext;
+   }
+   if ( chunk == NULL )
+   {
+      size_t chunkSize = ( size > arena->m_chunkSize ) ? size : arena->m_chunkSize;
+
+      chunk = (ArenaChunk*) malloc( CHUNK_HEADER + chunkSize );
+      if ( chunk == NULL )
+      {
+         return 0;
+      }
+      chunk->m_size = chunkSize;
+      if ( arena->m_pCurrent == NULL )
+      {
+         chunk->m_pNext = arena->m_pChunks;
+         arena->m_pChunks = chunk;
+      }
+      else
+      {
+         chunk->m_pNext = arena->m_pCurrent->m_pNext;
+         arena->m_pCurrent->m_pNext = chunk;
+      }
+      arena->m_reserved += CHUNK_HEADER + chunkSize;
+   }
+   arena->m_pCurrent = chunk;
+   arena->m_pTop = CHUNK_DATA( chunk );
+   arena->m_pEnd = arena->m_pTop + chunk->m_size;
+   return 1;
+}
+
+static void* arena_bump( LuaArena* arena, size_t size )
+{
+   void* result;
+
+   size = ARENA_ROUND( size );
+   if ( (size_t)( arena->m_pEnd - arena->m_pTop ) < size && !arena_nextchunk( arena, size ) )
+   {
+      return NULL;
+   }
+   result = arena->m_pTop;
+   arena->m_pTop += size;
+   arena->m_pLast = (char*) result;
+   arena->m_used += size;
+   if ( arena->m_used > arena->m_highWater )
+   {
+      arena->m_highWater = arena->m_used;
+   }
+   return result;
+}
+
+LuaArena* luaCreateArena( size_t chunkSize )
+{
+   LuaArena* arena = (LuaArena*) calloc( 1, sizeof( LuaArena ) );
+
+   if ( arena != NULL )
+   {
+      arena->m_chunkSize = ARENA_ROUND( ( chunkSize != 0 ) ? chunkSize : ARENA_CHUNK_SIZE );
+   }
+   return arena;
+}
+
+void luaDestroyArena( LuaArena* arena )
+{
+   while ( arena->m_pChunks != NULL )
+   {
+      ArenaChunk* chunk = arena->m_pChunks;
+
+      arena->m_pChunks = chunk->m_pNext;
+      free( chunk );
+   }
+   free( arena );
+}
+
+void luaResetArena( LuaArena* arena )
+{
+   arena->m_pCurrent = NULL;     /* the chunks are refilled from the first one */
+   arena->m_pTop = NULL;
+   arena->m_pEnd = NULL;
+   arena->m_pLast = NULL;
+   arena->m_used = 0;
+}
+
+void *luaArenaAlloc( void *ud, void *ptr, size_t osize, size_t nsize )
+{
+   LuaArena* arena = (LuaArena*) ud;
+   void* result;
+
+   if ( ptr == NULL )
+   {
+      /* 'osize' is the type of a new object, not a size */
+      return ( nsize == 0 ) ? NULL : arena_bump( arena, nsize );
+   }
+   if ( (char*) ptr == arena->m_pLast && ARENA_ROUND( nsize ) <= (size_t)( arena->m_pEnd - arena->m_pLast ) )
+   {
+      /* the last block grows, shrinks or is freed where it is */
+      arena->m_used = arena->m_used - ( arena->m_pTop - arena->m_pLast ) + ARENA_ROUND( nsize );
+      arena->m_pTop = arena->m_pLast + ARENA_ROUND( nsize );
+      if ( arena->m_used > arena->m_highWater )
+      {
+         arena->m_highWater = arena->m_used;
+      }
+      if ( nsize == 0 )
+      {
+         arena->m_pLast = NULL;
+         return NULL;
+      }
+      return ptr;
+   }
+   if ( nsize == 0 )
+   {
+      return NULL;                /* given back with the whole arena */
+   }
+   if ( nsize <= osize )
+   {
+      return ptr;
+   }
+   result = arena_bump( arena, nsize );
+   if ( result != NULL )
+   {
+      memcpy( result, ptr, osize );
+   }
+   return result;
+}
+
+void luaArenaFreeAll( void *ud )
+{
+   luaResetArena( (LuaArena*) ud );
+}
+
+size_t luaArenaUsed( LuaArena* arena )
+{
+   return arena->m_used;
+}
+
+size_t luaArenaHighWater( LuaArena* arena )
+{
+   return arena->m_highWater;
+}
+
+size_t luaArenaReserved( LuaArena* arena )
+{
+   return arena->m_reserved;
+}
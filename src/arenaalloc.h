@@ -0,0 +1,41 @@
+#ifndef ARENA_ALLOC_H_
+#define ARENA_ALLOC_H_
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+   /* A bump allocator for short-lived states: allocating moves a pointer,
+   * freeing does nothing (except for the last block allocated) and the whole
+   * arena is emptied at once. Its chunks are kept, warm, for the next state.
+   *
+   *    arena = luaCreateArena(0);
+   *    L = lua_newstate(luaArenaAlloc, arena);
+   *    lua_setallochooks(L, &hooks);      hooks.freeall = luaArenaFreeAll
+   *    ... run the request ...
+   *    lua_close(L);                      finalizers run, then one reset
+   *
+   * The same arena then serves the next lua_newstate. An arena is not
+   * thread safe: one state at a time.
+   */
+   typedef struct LuaArena LuaArena;
+
+   LuaArena* luaCreateArena( size_t chunkSize );      /* 0 for the default size */
+   void luaDestroyArena( LuaArena* arena );
+
+   void luaResetArena( LuaArena* arena );             /* every block is freed */
+
+   void *luaArenaAlloc( void *ud, void *ptr, size_t osize, size_t nsize );   /* lua_Alloc, ud is the arena */
+
+   void luaArenaFreeAll( void *ud );                  /* lua_AllocHooks.freeall */
+
+   size_t luaArenaUsed( LuaArena* arena );            /* bytes handed out since the last reset */
+   size_t luaArenaHighWater( LuaArena* arena );       /* most bytes ever in use at once */
+   size_t luaArenaReserved( LuaArena* arena );        /* bytes of all chunks */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //!ARENA_ALLOC_H_
@@ -1,70 +1,242 @@
-
-
-#include <string.h>
-#include <stdint.h>
-#include <stdlib.h>
-#include <assert.h>
-
-#include "list.h"
-#include "bufferalloc.h"
-
-
-typedef struct ListItem
-{
-   char* buffer;
-   ListNode listNode;
-}ListItem;
-
-static uint32_t bufferSize = 0;
-static ListNode freeList; 
-
-void luaCreateBufferAllocator( uint32_t bufSize, uint32_t bufferCount )
-{
-   uint32_t index = 0 ;
-   bufferSize =  bufSize ;
-   List_init( &freeList );
-
-   // Create "bufferCount" buffers of size "bufferSize".  Each buffer is allocated large enough
-   // such that the bytes in front of each buffer are large enough to hold a pointer to a ListEntry struct.
-   // This is used to get a reference to the ListEntry struct that manages the buffer
-
-   for ( ; index < bufferCount; ++index )
-   {
-      char* buffer = (char *)malloc(sizeof( ListItem ) + bufferSize );
-
-      ListItem* listItem = (ListItem*) buffer;
-      listItem->buffer = buffer + sizeof( ListItem );
-
-      List_addTail( &freeList, &listItem->listNode );
-   }
-}
-
-void luaReleaseBufferAllocator( void )
-{
-   while ( !List_isEmpty( &freeList ) )
-   {
-      ListItem* listItem = list_entry( List_removeHead( &freeList ), ListItem, listNode );
-      free((char*) listItem);
-   }
-}
-
-void luaRelease( void* buffer )
-{
-   // Get a pointer to the list item
-   ListItem* listItem = (ListItem*) ( ( (char*) buffer ) - sizeof( ListItem ) );
-   List_addTail( &freeList, &listItem->listNode );
-}
-
-void* luaAllocate( uint32_t size )
-{
-   void* result = NULL;
-   assert( size <= bufferSize );
-
-   if ( !List_isEmpty( &freeList ) )
-   {
-      result = list_entry( List_removeHead( &freeList ), ListItem, listNode )->buffer;
-   }
-
-   return result;
-}
-
+
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "bufferalloc.h"
+
+#define BUFFER_MIN_SIZE       16
+#define BUFFER_MAX_SIZE       8192
+#define BUFFER_MAX_CLASSES    10       /* 16 .. 8192 */
+#define BUFFER_DEFAULT_SIZE   4096
+#define BUFFER_DEFAULT_COUNT  1024
+
+/* A free buffer holds the link to the next free buffer of its class */
+typedef struct BufferNode
+{
+   struct BufferNode* m_pNext;
+}BufferNode;
+
+typedef struct BufferClass
+{
+   BufferNode* m_pFree;          /* buffers released to the class */
+   char* m_pTop;                 /* next buffer never handed out */
+   char* m_pEnd;                 /* end of the last whole buffer of the slab */
+   uint32_t m_bufferSize;
+}BufferClass;
+
+struct LuaBufferAllocator
+{
+   char* m_pSlabs;               /* the slabs of all classes, one after the other */
+   char* m_pSlabsEnd;
+   size_t m_slabSize;
+   uint32_t m_classNum;
+   uint32_t m_maxBufferSize;
+   size_t m_used;
+   size_t m_overflow;
+   BufferClass m_classes[BUFFER_MAX_CLASSES];
+   uint8_t m_classOfSize[BUFFER_MAX_SIZE / BUFFER_MIN_SIZE + 1];   /* indexed by 16-byte steps */
+};
+
+#define BUFFER_STEPS(s)       ( ( (s) + BUFFER_MIN_SIZE - 1 ) / BUFFER_MIN_SIZE )
+#define BUFFER_OWNS(a, p)     ( (char*)(p) >= (a)->m_pSlabs && (char*)(p) < (a)->m_pSlabsEnd )
+
+LuaBufferAllocator* luaCreateBufferAllocator( uint32_t bufSize, uint32_t bufferCount )
+{
+   LuaBufferAllocator* alloc;
+   uint32_t size = BUFFER_MIN_SIZE;
+   uint32_t index = 0;
+   uint32_t step;
+
+   if ( bufSize == 0 )
+   {
+      bufSize = BUFFER_DEFAULT_SIZE;
+   }
+   if ( bufferCount == 0 )
+   {
+      bufferCount = BUFFER_DEFAULT_COUNT;
+   }
+   if ( bufSize > BUFFER_MAX_SIZE )
+   {
+      bufSize = BUFFER_MAX_SIZE;
+   }
+
+   alloc = (LuaBufferAllocator*) calloc( 1, sizeof( LuaBufferAllocator ) );
+   if ( alloc == NULL )
+   {
+      return NULL;
+   }
+
+   /* One class per power of two, the last one large enough for "bufSize" */
+   for ( ; ; size *= 2, ++index )
+   {
+      alloc->m_classes[index].m_bufferSize = size;
+      if ( size >= bufSize )
+      {
+         break;
+      }
+   }
+   alloc->m_classNum = index + 1;
+   alloc->m_maxBufferSize = size;
+   alloc->m_slabSize = (size_t) size * bufferCount;
+
+   for ( step = 0, index = 0; step <= BUFFER_STEPS( size ); ++step )
+   {
+      while ( alloc->m_classes[index].m_bufferSize < step * BUFFER_MIN_SIZE )
+      {
+         ++index;
+      }
+      alloc->m_classOfSize[step] = (uint8_t) index;
+   }
+
+   /* The slabs are only reserved here; a buffer is touched when it is first carved */
+   alloc->m_pSlabs = (char*) malloc( alloc->m_slabSize * alloc->m_classNum );
+   if ( alloc->m_pSlabs == NULL )
+   {
+      free( alloc );
+      return NULL;
+   }
+   alloc->m_pSlabsEnd = alloc->m_pSlabs + alloc->m_slabSize * alloc->m_classNum;
+
+   for ( index = 0; index < alloc->m_classNum; ++index )
+   {
+      BufferClass* cls = &alloc->m_classes[index];
+      size_t count = alloc->m_slabSize / cls->m_bufferSize;
+
+      cls->m_pTop = alloc->m_pSlabs + index * alloc->m_slabSize;
+      cls->m_pEnd = cls->m_pTop + count * cls->m_bufferSize;
+   }
+   return alloc;
+}
+
+void luaReleaseBufferAllocator( LuaBufferAllocator* alloc )
+{
+   free( alloc->m_pSlabs );
+   free( alloc );
+}
+
+void luaRelease( LuaBufferAllocator* alloc, void* buffer )
+{
+   BufferClass* cls;
+   BufferNode* node = (BufferNode*) buffer;
+
+   assert( BUFFER_OWNS( alloc, buffer ) );
+   cls = &alloc->m_classes[ ( (char*) buffer - alloc->m_pSlabs ) / alloc->m_slabSize ];
+   node->m_pNext = cls->m_pFree;
+   cls->m_pFree = node;
+   alloc->m_used -= cls->m_bufferSize;
+}
+
+void* luaAllocate( LuaBufferAllocator* alloc, uint32_t size )
+{
+   BufferClass* cls;
+   void* result = NULL;
+
+   assert( size <= alloc->m_maxBufferSize );
+   cls = &alloc->m_classes[ alloc->m_classOfSize[ BUFFER_STEPS( size ) ] ];
+
+   if ( cls->m_pFree != NULL )
+   {
+      result = cls->m_pFree;
+      cls->m_pFree = cls->m_pFree->m_pNext;
+   }
+   else if ( cls->m_pTop < cls->m_pEnd )
+   {
+      result = cls->m_pTop;
+      cls->m_pTop += cls->m_bufferSize;
+   }
+   else
+   {
+      return NULL;
+   }
+   alloc->m_used += cls->m_bufferSize;
+   return result;
+}
+
+void *luaBufferAlloc( void *ud, void *ptr, size_t osize, size_t nsize )
+{
+   LuaBufferAllocator* alloc = (LuaBufferAllocator*) ud;
+   int owned = ( ptr != NULL && BUFFER_OWNS( alloc, ptr ) );
+   void* result = NULL;
+
+   if ( nsize == 0 )
+   {
+      if ( owned )
+      {
+         luaRelease( alloc, ptr );
+      }
+      else
+      {
+         free( ptr );
+      }
+      return NULL;
+   }
+   if ( ptr == NULL )
+   {
+      osize = 0;                  /* 'osize' is the type of a new object, not a size */
+   }
+   if ( owned )
+   {
+      uint32_t bufferSize = alloc->m_classes[ ( (char*) ptr - alloc->m_pSlabs ) / alloc->m_slabSize ].m_bufferSize;
+
+      if ( nsize <= bufferSize && nsize > bufferSize / 2 )
+      {
+         return ptr;               /* still the right class */
+      }
+   }
+
+   if ( nsize <= alloc->m_maxBufferSize )
+   {
+      result = luaAllocate( alloc, (uint32_t) nsize );
+   }
+   if ( result == NULL )
+   {
+      if ( ptr != NULL && !owned )
+      {
+         return realloc( ptr, nsize );
+      }
+      result = malloc( nsize );
+      if ( result == NULL )
+      {
+         /* A shrinking buffer must not fail: it stays where it is */
+         return ( owned && nsize < osize ) ? ptr : NULL;
+      }
+      alloc->m_overflow++;
+   }
+   if ( ptr != NULL )
+   {
+      memcpy( result, ptr, ( osize < nsize ) ? osize : nsize );
+      if ( owned )
+      {
+         luaRelease( alloc, ptr );
+      }
+      else
+      {
+         free( ptr );
+      }
+   }
+   return result;
+}
+
+size_t luaBufferAllocUsed( LuaBufferAllocator* alloc )
+{
+   return alloc->m_used;
+}
+
+size_t luaBufferAllocCarved( LuaBufferAllocator* alloc )
+{
+   size_t carved = 0;
+   uint32_t index;
+
+   for ( index = 0; index < alloc->m_classNum; ++index )
+   {
+      carved += alloc->m_classes[index].m_pTop - ( alloc->m_pSlabs + index * alloc->m_slabSize );
+   }
+   return carved;
+}
+
+size_t luaBufferAllocOverflow( LuaBufferAllocator* alloc )
+{
+   return alloc->m_overflow;
+}
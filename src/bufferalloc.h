@@ -1,19 +1,43 @@
-#ifndef BUFFER_ALLOC_H_
-#define BUFFER_ALLOC_H_
-#include <stdint.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-   void luaCreateBufferAllocator( uint32_t bufferSize, uint32_t bufferCount ) ;
-   void luaReleaseBufferAllocator( void );
-
-   void luaRelease( void* buffer );
-   void* luaAllocate( uint32_t size );
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif //!BUFFER_ALLOC_H_
\ No newline at end of file
+#ifndef BUFFER_ALLOC_H_
+#define BUFFER_ALLOC_H_
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+   /* Fixed-size buffers carved from one contiguous slab per class. The
+   * classes are the powers of two from 16 bytes up to 'bufferSize', and every
+   * class gets a slab of 'bufferSize' * 'bufferCount' bytes, all of them in a
+   * single reservation: the owner of a buffer is found from its address, so
+   * releasing one needs no size and no header. Allocating pops the free list
+   * of the class or carves the next buffer of its slab, releasing pushes the
+   * buffer back, both in O(1).
+   *
+   *    alloc = luaCreateBufferAllocator(0, 0);
+   *    L = lua_newstate(luaBufferAlloc, alloc);
+   *
+   * Blocks larger than 'bufferSize', and blocks of a class whose slab is
+   * used up, come from malloc. An allocator is not thread safe: one state
+   * at a time.
+   */
+   typedef struct LuaBufferAllocator LuaBufferAllocator;
+
+   LuaBufferAllocator* luaCreateBufferAllocator( uint32_t bufferSize, uint32_t bufferCount );   /* 0 for the defaults */
+   void luaReleaseBufferAllocator( LuaBufferAllocator* alloc );
+
+   void luaRelease( LuaBufferAllocator* alloc, void* buffer );
+   void* luaAllocate( LuaBufferAllocator* alloc, uint32_t size );   /* NULL when the class is used up */
+
+   void *luaBufferAlloc( void *ud, void *ptr, size_t osize, size_t nsize );   /* lua_Alloc, ud is the allocator */
+
+   size_t luaBufferAllocUsed( LuaBufferAllocator* alloc );       /* bytes of the buffers handed out */
+   size_t luaBufferAllocCarved( LuaBufferAllocator* alloc );     /* bytes of the slabs touched so far */
+   size_t luaBufferAllocOverflow( LuaBufferAllocator* alloc );   /* blocks that went to malloc */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //!BUFFER_ALLOC_H_
@@ -0,0 +1,145 @@
+
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "debugalloc.h"
+
+#define DEBUG_MAGIC        0x4B4C4244u    /* "DBLK" */
+#define DEBUG_DEAD         0x44414544u    /* "DEAD", a freed block */
+#define DEBUG_GUARD_SIZE   16
+#define DEBUG_GUARD_BYTE   0xFD
+#define DEBUG_NEW_BYTE     0xCD
+#define DEBUG_FREE_BYTE    0xDD
+
+/* In front of every block; 16 bytes so the block keeps malloc's alignment */
+typedef struct DebugHeader
+{
+   size_t m_size;
+   size_t m_magic;
+}DebugHeader;
+
+struct LuaDebugAlloc
+{
+   size_t m_live;
+   size_t m_blocks;
+};
+
+#define DEBUG_HEADER(p)    ( (DebugHeader*)(p) - 1 )
+#define DEBUG_GUARD(h)     ( (unsigned char*)( (h) + 1 ) + (h)->m_size )
+
+static void debug_fail( const void* ptr, const char* what )
+{
+   fprintf( stderr, "debugalloc: block %p: %s\n", ptr, what );
+   abort();
+}
+
+/* Check a block handed back by Lua and return its header */
+static DebugHeader* debug_check( void* ptr, size_t osize )
+{
+   DebugHeader* header = DEBUG_HEADER( ptr );
+   unsigned char* guard;
+   int index;
+
+   if ( header->m_magic == DEBUG_DEAD )
+   {
+      debug_fail( ptr, "already freed" );
+   }
+   if ( header->m_magic != DEBUG_MAGIC )
+   {
+      debug_fail( ptr, "not allocated here" );
+   }
+   if ( header->m_size != osize )
+   {
+      fprintf( stderr, "debugalloc: block %p: size %lu given back as %lu\n",
+         ptr, (unsigned long) header->m_size, (unsigned long) osize );
+      abort();
+   }
+   guard = DEBUG_GUARD( header );
+   for ( index = 0; index < DEBUG_GUARD_SIZE; ++index )
+   {
+      if ( guard[index] != DEBUG_GUARD_BYTE )
+      {
+         debug_fail( ptr, "written past its end" );
+      }
+   }
+   return header;
+}
+
+LuaDebugAlloc* luaCreateDebugAlloc( void )
+{
+   return (LuaDebugAlloc*) calloc( 1, sizeof( LuaDebugAlloc ) );
+}
+
+void luaDestroyDebugAlloc( LuaDebugAlloc* dbg )
+{
+   if ( dbg->m_blocks != 0 )
+   {
+      fprintf( stderr, "debugalloc: %lu blocks (%lu bytes) never freed\n",
+         (unsigned long) dbg->m_blocks, (unsigned long) dbg->m_live );
+   }
+   free( dbg );
+}
+
+void *luaDebugAlloc( void *ud, void *ptr, size_t osize, size_t nsize )
+{
+   LuaDebugAlloc* dbg = (LuaDebugAlloc*) ud;
+   DebugHeader* header = NULL;
+   DebugHeader* result;
+
+   if ( ptr != NULL )
+   {
+      header = debug_check( ptr, osize );
+   }
+   else
+   {
+      osize = 0;                  /* 'osize' is the type of a new object, not a size */
+   }
+   if ( nsize == 0 )
+   {
+      if ( header != NULL )
+      {
+         memset( ptr, DEBUG_FREE_BYTE, osize );
+         header->m_magic = DEBUG_DEAD;
+         dbg->m_live -= osize;
+         dbg->m_blocks--;
+         free( header );
+      }
+      return NULL;
+   }
+
+   /* Always move the block, so that a stale pointer to the old one shows */
+   result = (DebugHeader*) malloc( sizeof( DebugHeader ) + nsize + DEBUG_GUARD_SIZE );
+   if ( result == NULL )
+   {
+      return NULL;
+   }
+   result->m_size = nsize;
+   result->m_magic = DEBUG_MAGIC;
+   memset( result + 1, DEBUG_NEW_BYTE, nsize );
+   memset( DEBUG_GUARD( result ), DEBUG_GUARD_BYTE, DEBUG_GUARD_SIZE );
+   dbg->m_live += nsize;
+   dbg->m_blocks++;
+
+   if ( header != NULL )
+   {
+      memcpy( result + 1, ptr, ( osize < nsize ) ? osize : nsize );
+      memset( ptr, DEBUG_FREE_BYTE, osize );
+      header->m_magic = DEBUG_DEAD;
+      dbg->m_live -= osize;
+      dbg->m_blocks--;
+      free( header );
+   }
+   return result + 1;
+}
+
+size_t luaDebugAllocLive( LuaDebugAlloc* dbg )
+{
+   return dbg->m_live;
+}
+
+size_t luaDebugAllocBlocks( LuaDebugAlloc* dbg )
+{
+   return dbg->m_blocks;
+}
@@ -0,0 +1,37 @@
+#ifndef DEBUG_ALLOC_H_
+#define DEBUG_ALLOC_H_
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+   /* A checking allocator for hunting memory bugs, not for speed. Every block
+   * comes from malloc with a header recording its size and guard bytes after
+   * it. A block given back with the wrong size, a damaged guard or a pointer
+   * that was never handed out aborts with a message; new bytes are filled
+   * with 0xCD and freed blocks with 0xDD so stale reads stand out.
+   *
+   *    dbg = luaCreateDebugAlloc();
+   *    L = lua_newstate(luaDebugAlloc, dbg);
+   *    ...
+   *    lua_close(L);
+   *    luaDestroyDebugAlloc(dbg);        reports the blocks never freed
+   *
+   * Not thread safe: one state at a time.
+   */
+   typedef struct LuaDebugAlloc LuaDebugAlloc;
+
+   LuaDebugAlloc* luaCreateDebugAlloc( void );
+   void luaDestroyDebugAlloc( LuaDebugAlloc* dbg );
+
+   void *luaDebugAlloc( void *ud, void *ptr, size_t osize, size_t nsize );   /* lua_Alloc, ud is the allocator */
+
+   size_t luaDebugAllocLive( LuaDebugAlloc* dbg );      /* bytes not freed yet */
+   size_t luaDebugAllocBlocks( LuaDebugAlloc* dbg );    /* blocks not freed yet */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //!DEBUG_ALLOC_H_
@@ -1,228 +1,349 @@
-
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <stdarg.h>
-#include <string.h>
-
-#include "CmemPool.h"
-
-static lua_State *L = NULL;
-
-/* call a function `f' defined in Lua */
-double f (double x, double y) 
-{
-   double z = 0.0;
-
-   /* push functions and arguments */
-   lua_getglobal(L, "lua_fun");  /* function to be called */
-   lua_pushnumber(L, x);   /* push 1st argument */
-   lua_pushnumber(L, y);   /* push 2nd argument */
-
-   /* do the call (2 arguments, 1 result) */
-   if (lua_pcall(L, 2, 1, 0) != 0)
-      fprintf(stderr, "error running function `lua_fun': %s",
-      lua_tostring(L, -1));
-
-   /* retrieve result */
-   if (!lua_isnumber(L, -1))
-      fprintf(stderr, "function `f' must return a number");
-   z = lua_tonumber(L, -1);
-   lua_pop(L, 1);  /* pop returned value */
-   return z;
-}
-
-
-/** 
-* Referenced  from https://www.lua.org/pil/25.3.html 
-*/
-void call_va (const char *func, const char *sig, ...) {
-   va_list vl;
-   int narg, nres;  /* number of arguments and results */
-
-   //lua_settop(L, 0); /* Clear lua stack */
-
-   va_start(vl, sig);
-   lua_getglobal(L, func);  /* get function */
-   if(!lua_isfunction(L, -1 ))
-   {
-      return ;
-   }
-
-   /* push arguments */
-   narg = 0;
-   while (*sig) {  /* push arguments */
-      switch (*sig++) {
-
-      case 'd':  /* double argument */
-         lua_pushnumber(L, va_arg(vl, double));
-         break;
-
-      case 'i':  /* int argument */
-         lua_pushnumber(L, va_arg(vl, int));
-         break;
-
-      case 's':  /* string argument */
-         lua_pushstring(L, va_arg(vl, char *));
-         break;
-
-      case '>':
-         goto endwhile;
-
-      default:
-         fprintf(stderr, "invalid option (%c)", *(sig - 1));
-      }
-      narg++;
-      luaL_checkstack(L, 1, "too many arguments");
-   } endwhile:
-
-   /* do the call */
-   nres = strlen(sig);  /* number of expected results */
-   if (lua_pcall(L, narg, nres, 0) != 0)  /* do the call */
-      fprintf(stderr, "error running function `%s': %s\n",
-      func, lua_tostring(L, -1));
-
-   /* retrieve results */
-   nres = -nres;  /* stack index of first result */
-   while (*sig) {  /* get results */
-      switch (*sig++) {
-
-      case 'd':  /* double result */
-         if (!lua_isnumber(L, nres))
-            fprintf(stderr, "wrong result type\n");
-         *va_arg(vl, double *) = lua_tonumber(L, nres);
-         break;
-
-      case 'i':  /* int result */
-         if (!lua_isnumber(L, nres))
-            fprintf(stderr, "wrong result type\n");
-         *va_arg(vl, int *) = (int)lua_tonumber(L, nres);
-         break;
-
-      case 's':  /* string result */
-         if (!lua_isstring(L, nres))
-            fprintf(stderr, "wrong result type\n");
-         *va_arg(vl, const char **) = lua_tostring(L, nres);
-         break;
-
-      default:
-         fprintf(stderr, "invalid option (%c)\n", *(sig - 1));
-      }
-      nres++;
-   }
-   va_end(vl);
-}
-
-void bail(lua_State *L, char *msg)
-{
-   fprintf(stderr, "\nFATAL ERROR:\n  %s: %s\n\n",
-      msg, lua_tostring(L, -1));
-   exit(1);
-}
-
-static int l_doubler (lua_State *L) 
-{
-   double d = lua_tonumber(L, 1);  /* get argument */
-   lua_pushnumber(L, d*2);  /* push result */
-   return 1;  /* number of results */
-}
-
-static int l_registerButonClick(lua_State* L )
-{
-   size_t len = 0;
-   const char* callbk = lua_tolstring(L, 1, &len);
-   int widgetId = (int)lua_tointeger(L,2 );
-
-   call_va(callbk,"i>", widgetId );
-
-   return 0;  /* number of results */
-}
-
-typedef struct Tracker 
-{
-   size_t m_usage;
-}Tracker;
-
-
-static Tracker g_tracker;
-
-static void *custom_lua_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
-{
-   Tracker* pTracker = (Tracker*)ud;
-
-   if (nsize == 0) 
-   {
-      if( osize != 0 )
-      {
-         pTracker->m_usage -= osize;
-         //printf("Freed %d bytes\n", osize );
-         luaReleaseMem(ptr);
-      }
-      return NULL;
-   }
-   else
-   {
-      pTracker->m_usage -= osize;
-      pTracker->m_usage += nsize;
-      //printf("Rellocation for %d bytes\n", nsize );
-      return    luaReallocMem(ptr, nsize ); 
-   }
-}
-
-int main(void)
-{
-   int status = -1;
-   double sum = 0.0;
-   double x = 2, y = 4.0;
-   const char* str ="Prashant P0W";
-
-   luaCreateMem(512, 2048);
-
-   g_tracker.m_usage = 0;
-
-   L = lua_newstate(custom_lua_alloc, &g_tracker );
-
-   printf("current usage: %d bytes \n", g_tracker.m_usage);
-
-   luaL_openlibs(L); /* Load Lua libraries */
-
-   printf("current usage: %d bytes \n", g_tracker.m_usage);
-
-   status = luaL_loadfile(L, "D:/lua-5.3.4/src/foo.lua");
-   if (status) 
-   {   
-      bail( L, "Script Load Error luaL_loadfile failed" );
-   }
-   printf("current usage: %d bytes \n", g_tracker.m_usage);
-
-   if (lua_pcall(L, 0, 0, 0))
-   {  /* PRIMING RUN. FORGET THIS AND YOU'RE TOAST */
-      /* Error out if Lua file has an error */
-      bail(L, "lua_pcall() failed");          
-   }
-
-   printf("current usage: %d bytes \n", g_tracker.m_usage);
-
-   lua_pushcfunction(L, l_doubler);
-   lua_setglobal(L, "mydoubler");
-
-   lua_pushcfunction(L, l_registerButonClick);
-   lua_setglobal(L, "registerButonClick");
-
-   call_va( "lua_fun",  "dd>d", x, y, &sum) ;
-   printf( "Result %.6f\n",sum);
-
-   call_va( "lua_test", "s>", str );
-
-   printf("current usage: %d bytes \n", g_tracker.m_usage);
-
-   lua_close(L);   /* Cya, Lua */
-
-   printf("current usage: %d bytes \n", g_tracker.m_usage);
-
-   luaDestroyMem();
-
-   return 0;
+
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "allocadapter.h"
+#include "alloctrace.h"
+
+static lua_State *L = NULL;
+
+/* call a function `f' defined in Lua */
+double f (double x, double y) 
+{
+   double z = 0.0;
+
+   /* push functions and arguments */
+   lua_getglobal(L, "lua_fun");  /* function to be called */
+   lua_pushnumber(L, x);   /* push 1st argument */
+   lua_pushnumber(L, y);   /* push 2nd argument */
+
+   /* do the call (2 arguments, 1 result) */
+   if (lua_pcall(L, 2, 1, 0) != 0)
+      fprintf(stderr, "error running function `lua_fun': %s",
+      lua_tostring(L, -1));
+
+   /* retrieve result */
+   if (!lua_isnumber(L, -1))
+      fprintf(stderr, "function `f' must return a number");
+   z = lua_tonumber(L, -1);
+   lua_pop(L, 1);  /* pop returned value */
+   return z;
+}
+
+
+/** 
+* Referenced  from https://www.lua.org/pil/25.3.html 
+*/
+void call_va (const char *func, const char *sig, ...) {
+   va_list vl;
+   int narg, nres;  /* number of arguments and results */
+
+   //lua_settop(L, 0); /* Clear lua stack */
+
+   va_start(vl, sig);
+   lua_getglobal(L, func);  /* get function */
+   if(!lua_isfunction(L, -1 ))
+   {
+      return ;
+   }
+
+   /* push arguments */
+   narg = 0;
+   while (*sig) {  /* push arguments */
+      switch (*sig++) {
+
+      case 'd':  /* double argument */
+         lua_pushnumber(L, va_arg(vl, double));
+         break;
+
+      case 'i':  /* int argument */
+         lua_pushnumber(L, va_arg(vl, int));
+         break;
+
+      case 's':  /* string argument */
+         lua_pushstring(L, va_arg(vl, char *));
+         break;
+
+      case '>':
+         goto endwhile;
+
+      default:
+         fprintf(stderr, "invalid option (%c)", *(sig - 1));
+      }
+      narg++;
+      luaL_checkstack(L, 1, "too many arguments");
+   } endwhile:
+
+   /* do the call */
+   nres = strlen(sig);  /* number of expected results */
+   if (lua_pcall(L, narg, nres, 0) != 0)  /* do the call */
+      fprintf(stderr, "error running function `%s': %s\n",
+      func, lua_tostring(L, -1));
+
+   /* retrieve results */
+   nres = -nres;  /* stack index of first result */
+   while (*sig) {  /* get results */
+      switch (*sig++) {
+
+      case 'd':  /* double result */
+         if (!lua_isnumber(L, nres))
+            fprintf(stderr, "wrong result type\n");
+         *va_arg(vl, double *) = lua_tonumber(L, nres);
+         break;
+
+      case 'i':  /* int result */
+         if (!lua_isnumber(L, nres))
+            fprintf(stderr, "wrong result type\n");
+         *va_arg(vl, int *) = (int)lua_tonumber(L, nres);
+         break;
+
+      case 's':  /* string result */
+         if (!lua_isstring(L, nres))
+            fprintf(stderr, "wrong result type\n");
+         *va_arg(vl, const char **) = lua_tostring(L, nres);
+         break;
+
+      default:
+         fprintf(stderr, "invalid option (%c)\n", *(sig - 1));
+      }
+      nres++;
+   }
+   va_end(vl);
+}
+
+void bail(lua_State *L, char *msg)
+{
+   fprintf(stderr, "\nFATAL ERROR:\n  %s: %s\n\n",
+      msg, lua_tostring(L, -1));
+   exit(1);
+}
+
+static int l_doubler (lua_State *L) 
+{
+   double d = lua_tonumber(L, 1);  /* get argument */
+   lua_pushnumber(L, d*2);  /* push result */
+   return 1;  /* number of results */
+}
+
+static int l_registerButonClick(lua_State* L )
+{
+   size_t len = 0;
+   const char* callbk = lua_tolstring(L, 1, &len);
+   int widgetId = (int)lua_tointeger(L,2 );
+
+   call_va(callbk,"i>", widgetId );
+
+   return 0;  /* number of results */
+}
+
+typedef struct Tracker 
+{
+   size_t m_usage;
+   const LuaAllocator* m_pAllocator;   /* LUA_ALLOCATOR names it, else the build default */
+   void* m_ud;                         /* the allocator's own state */
+   LuaAllocTrace* m_pTrace;            /* set when LUA_ALLOC_TRACE names a file */
+}Tracker;
+
+
+static Tracker g_tracker;
+
+/* Counts and traces the blocks of every backend; each wrapper below passes its own 'alloc'.
+   The state gets a 'tracked_##id' wrapper, never the backend itself, so lmem.c's direct call
+   of LUAI_ALLOCF (see 'callfrealloc') does not apply to this host */
+static inline void *tracked_alloc (Tracker* pTracker, lua_Alloc alloc, void *ptr, size_t osize, size_t nsize)
+{
+   void* result = alloc(pTracker->m_ud, ptr, osize, nsize);
+
+   if( result != NULL || nsize == 0 )    /* a failed call changes nothing */
+   {
+      if( ptr != NULL )    /* for a new object 'osize' is its type, not a size */
+      {
+         pTracker->m_usage -= osize;
+      }
+      pTracker->m_usage += nsize;
+   }
+   if( pTracker->m_pTrace != NULL )
+   {
+      luaTraceAlloc(pTracker->m_pTrace, ptr, osize, nsize, result);   /* replay with allocreplay */
+   }
+   return result;
+}
+
+#define TRACKED_ALLOC(id, name, alloc) \
+   static void *tracked_##id (void *ud, void *ptr, size_t osize, size_t nsize) \
+   { \
+      return tracked_alloc((Tracker*)ud, alloc, ptr, osize, nsize); \
+   }
+LUA_ALLOCATORS(TRACKED_ALLOC)
+
+#define TRACKED_ENTRY(id, name, alloc)    tracked_##id,
+static const lua_Alloc g_trackedAllocs[LUA_ALLOCATOR_NUM] = { LUA_ALLOCATORS(TRACKED_ENTRY) };
+
+static void custom_gc_cycle (void *ud)
+{
+   Tracker* pTracker = (Tracker*)ud;
+   if( pTracker->m_pAllocator->m_pHooks->gccycle != NULL )
+   {
+      pTracker->m_pAllocator->m_pHooks->gccycle(pTracker->m_ud);   /* e.g. give the empty pool slabs back */
+   }
+}
+
+static void custom_free_all (void *ud)
+{
+   Tracker* pTracker = (Tracker*)ud;
+   pTracker->m_pAllocator->m_pHooks->freeall(pTracker->m_ud);
+   pTracker->m_usage = 0;
+}
+
+static int custom_pressure (void *ud)
+{
+   Tracker* pTracker = (Tracker*)ud;
+
+   if( pTracker->m_pAllocator->m_pHooks->pressure == NULL )
+   {
+      return -1;
+   }
+   return pTracker->m_pAllocator->m_pHooks->pressure(pTracker->m_ud);
+}
+
+static void custom_trim (void *ud)
+{
+   Tracker* pTracker = (Tracker*)ud;
+   if( pTracker->m_pAllocator->m_pHooks->trim != NULL )
+   {
+      pTracker->m_pAllocator->m_pHooks->trim(pTracker->m_ud);
+   }
+}
+
+static void custom_free_async (void *ud, void *ptr, size_t osize)
+{
+   Tracker* pTracker = (Tracker*)ud;
+
+   pTracker->m_usage -= osize;
+   if( pTracker->m_pTrace != NULL )
+   {
+      luaTraceAlloc(pTracker->m_pTrace, ptr, osize, 0, NULL);
+   }
+   pTracker->m_pAllocator->m_pHooks->freeasync(pTracker->m_ud, ptr, osize);
+}
+
+static void custom_free_batch (void *ud, void **ptrs, size_t *osizes, int n)
+{
+   Tracker* pTracker = (Tracker*)ud;
+   int i;
+
+   for( i = 0; i < n; i++ )
+   {
+      pTracker->m_usage -= osizes[i];
+      if( pTracker->m_pTrace != NULL )
+      {
+         luaTraceAlloc(pTracker->m_pTrace, ptrs[i], osizes[i], 0, NULL);
+      }
+   }
+   pTracker->m_pAllocator->m_pHooks->freebatch(pTracker->m_ud, ptrs, osizes, n);
+}
+
+/* The optional frees are only forwarded when the backend has them (see main) */
+static lua_AllocHooks g_allocHooks = { custom_gc_cycle, NULL, custom_pressure, custom_trim, NULL, NULL };
+
+int main(void)
+{
+   int status = -1;
+   double sum = 0.0;
+   double x = 2, y = 4.0;
+   const char* str ="Prashant P0W";
+   MemPoolStats stats;
+   int isPool;
+
+   g_tracker.m_pAllocator = luaFindAllocator(getenv("LUA_ALLOCATOR"));
+   if( g_tracker.m_pAllocator == NULL )
+   {
+      fprintf(stderr, "unknown LUA_ALLOCATOR %s\n", getenv("LUA_ALLOCATOR"));
+      return 1;
+   }
+   isPool = (g_tracker.m_pAllocator->m_alloc == luaMemAlloc);
+   g_tracker.m_ud = g_tracker.m_pAllocator->m_create();
+   g_tracker.m_usage = 0;
+   g_tracker.m_pTrace = getenv("LUA_ALLOC_TRACE") ? luaOpenAllocTrace(getenv("LUA_ALLOC_TRACE")) : NULL;
+   printf("allocator: %s\n", g_tracker.m_pAllocator->m_name);
+
+   L = lua_newstate(g_trackedAllocs[g_tracker.m_pAllocator->m_id], &g_tracker );
+   if( g_tracker.m_pAllocator->m_pHooks != NULL )
+   {
+      const lua_AllocHooks* pHooks = g_tracker.m_pAllocator->m_pHooks;
+
+      g_allocHooks.freeall = pHooks->freeall != NULL ? custom_free_all : NULL;
+      g_allocHooks.freeasync = pHooks->freeasync != NULL ? custom_free_async : NULL;
+      g_allocHooks.freebatch = pHooks->freebatch != NULL ? custom_free_batch : NULL;
+      lua_setallochooks(L, &g_allocHooks);
+   }
+   if( isPool )
+   {
+      lua_pushlightuserdata(L, g_tracker.m_ud);   /* for mempool.stats() */
+      lua_setfield(L, LUA_REGISTRYINDEX, LUA_MEMPOOLKEY);
+   }
+
+   printf("current usage: %lu bytes \n", (unsigned long)g_tracker.m_usage);
+
+   luaL_openlibs(L); /* Load Lua libraries */
+
+   printf("current usage: %lu bytes \n", (unsigned long)g_tracker.m_usage);
+
+   status = luaL_loadfile(L, "D:/lua-5.3.4/src/foo.lua");
+   if (status) 
+   {   
+      bail( L, "Script Load Error luaL_loadfile failed" );
+   }
+   printf("current usage: %lu bytes \n", (unsigned long)g_tracker.m_usage);
+
+   if (lua_pcall(L, 0, 0, 0))
+   {  /* PRIMING RUN. FORGET THIS AND YOU'RE TOAST */
+      /* Error out if Lua file has an error */
+      bail(L, "lua_pcall() failed");          
+   }
+
+   printf("current usage: %lu bytes \n", (unsigned long)g_tracker.m_usage);
+
+   lua_pushcfunction(L, l_doubler);
+   lua_setglobal(L, "mydoubler");
+
+   lua_pushcfunction(L, l_registerButonClick);
+   lua_setglobal(L, "registerButonClick");
+
+   call_va( "lua_fun",  "dd>d", x, y, &sum) ;
+   printf( "Result %.6f\n",sum);
+
+   call_va( "lua_test", "s>", str );
+
+   printf("current usage: %lu bytes \n", (unsigned long)g_tracker.m_usage);
+   if( isPool )
+   {
+      CMemPool* pPool = (CMemPool*)g_tracker.m_ud;
+
+      printf("pool: strings %lu, tables %lu, functions %lu bytes\n",
+         (unsigned long)luaMemArenaFootprint(pPool, MEMPOOL_ARENA_STRING),
+         (unsigned long)luaMemArenaFootprint(pPool, MEMPOOL_ARENA_TABLE),
+         (unsigned long)luaMemArenaFootprint(pPool, MEMPOOL_ARENA_FUNCTION));
+      luaMemStats(pPool, &stats);
+      printf("pool: live %lu, peak %lu, fallback %llu, failed %llu, fragmentation %.1f%%\n",
+         (unsigned long)stats.m_liveBytes, (unsigned long)stats.m_peakBytes,
+         stats.m_sysAllocNum, stats.m_failedNum, stats.m_fragmentation * 100);
+   }
+
+   lua_close(L);   /* Cya, Lua */
+
+   printf("current usage: %lu bytes \n", (unsigned long)g_tracker.m_usage);
+
+   g_tracker.m_pAllocator->m_destroy(g_tracker.m_ud);
+   if( g_tracker.m_pTrace != NULL )
+   {
+      luaCloseAllocTrace(g_tracker.m_pTrace);
+   }
+
+   return 0;
 }
\ No newline at end of file
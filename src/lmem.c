@@ -1,100 +1,154 @@
-/*
-** $Id: lmem.c,v 1.91 2015/03/06 19:45:54 roberto Exp $
-** Interface to Memory Manager
-** See Copyright Notice in lua.h
-*/
-
-#define lmem_c
-#define LUA_CORE
-
-#include "lprefix.h"
-
-
-#include <stddef.h>
-
-#include "lua.h"
-
-#include "ldebug.h"
-#include "ldo.h"
-#include "lgc.h"
-#include "lmem.h"
-#include "lobject.h"
-#include "lstate.h"
-
-
-
-/*
-** About the realloc function:
-** void * frealloc (void *ud, void *ptr, size_t osize, size_t nsize);
-** ('osize' is the old size, 'nsize' is the new size)
-**
-** * frealloc(ud, NULL, x, s) creates a new block of size 's' (no
-** matter 'x').
-**
-** * frealloc(ud, p, x, 0) frees the block 'p'
-** (in this specific case, frealloc must return NULL);
-** particularly, frealloc(ud, NULL, 0, 0) does nothing
-** (which is equivalent to free(NULL) in ISO C)
-**
-** frealloc returns NULL if it cannot create or reallocate the area
-** (any reallocation to an equal or smaller size cannot fail!)
-*/
-
-
-
-#define MINSIZEARRAY	4
-
-
-void *luaM_growaux_ (lua_State *L, void *block, int *size, size_t size_elems,
-                     int limit, const char *what) {
-  void *newblock;
-  int newsize;
-  if (*size >= limit/2) {  /* cannot double it? */
-    if (*size >= limit)  /* cannot grow even a little? */
-      luaG_runerror(L, "too many %s (limit is %d)", what, limit);
-    newsize = limit;  /* still have at least one free place */
-  }
-  else {
-    newsize = (*size)*2;
-    if (newsize < MINSIZEARRAY)
-      newsize = MINSIZEARRAY;  /* minimum size */
-  }
-  newblock = luaM_reallocv(L, block, *size, newsize, size_elems);
-  *size = newsize;  /* update only when everything else is OK */
-  return newblock;
-}
-
-
-l_noret luaM_toobig (lua_State *L) {
-  luaG_runerror(L, "memory allocation error: block too big");
-}
-
-
-
-/*
-** generic allocation routine.
-*/
-void *luaM_realloc_ (lua_State *L, void *block, size_t osize, size_t nsize) {
-  void *newblock;
-  global_State *g = G(L);
-  size_t realosize = (block) ? osize : 0;
-  lua_assert((realosize == 0) == (block == NULL));
-#if defined(HARDMEMTESTS)
-  if (nsize > realosize && g->gcrunning)
-    luaC_fullgc(L, 1);  /* force a GC whenever possible */
-#endif
-  newblock = (*g->frealloc)(g->ud, block, osize, nsize);
-  if (newblock == NULL && nsize > 0) {
-    lua_assert(nsize > realosize);  /* cannot fail when shrinking a block */
-    if (g->version) {  /* is state fully built? */
-      luaC_fullgc(L, 1);  /* try to free some memory... */
-      newblock = (*g->frealloc)(g->ud, block, osize, nsize);  /* try again */
-    }
-    if (newblock == NULL)
-      luaD_throw(L, LUA_ERRMEM);
-  }
-  lua_assert((nsize == 0) == (newblock == NULL));
-  g->GCdebt = (g->GCdebt + nsize) - realosize;
-  return newblock;
-}
-
+/*
+** $Id: lmem.c,v 1.91 2015/03/06 19:45:54 roberto Exp $
+** Interface to Memory Manager
+** See Copyright Notice in lua.h
+*/
+
+#define lmem_c
+#define LUA_CORE
+
+#include "lprefix.h"
+
+
+#include <stddef.h>
+
+#include "lua.h"
+
+#include "ldebug.h"
+#include "ldo.h"
+#include "lgc.h"
+#include "lmem.h"
+#include "lobject.h"
+#include "lstate.h"
+
+
+
+/*
+** About the realloc function:
+** void * frealloc (void *ud, void *ptr, size_t osize, size_t nsize);
+** ('osize' is the old size, 'nsize' is the new size)
+**
+** * frealloc(ud, NULL, x, s) creates a new block of size 's' (no
+** matter 'x').
+**
+** * frealloc(ud, p, x, 0) frees the block 'p'
+** (in this specific case, frealloc must return NULL);
+** particularly, frealloc(ud, NULL, 0, 0) does nothing
+** (which is equivalent to free(NULL) in ISO C)
+**
+** frealloc returns NULL if it cannot create or reallocate the area
+** (any reallocation to an equal or smaller size cannot fail!)
+*/
+
+
+
+/*
+** Call to the allocator of the state. A build that knows which lua_Alloc
+** its states run on (make ALLOC=... defines LUAI_ALLOCF) calls it
+** directly for those states, so the common path has no indirect call;
+** a state on any other allocator goes through 'frealloc'.
+*/
+#if defined(LUAI_ALLOCF)
+extern void *LUAI_ALLOCF (void *ud, void *ptr, size_t osize, size_t nsize);
+#define callfrealloc(g,block,os,ns) \
+	((g)->frealloc == LUAI_ALLOCF ? LUAI_ALLOCF((g)->ud, block, os, ns) \
+	                              : (*(g)->frealloc)((g)->ud, block, os, ns))
+#else
+#define callfrealloc(g,block,os,ns)	((*(g)->frealloc)((g)->ud, block, os, ns))
+#endif
+
+
+
+#define MINSIZEARRAY	4
+
+
+void *luaM_growaux_ (lua_State *L, void *block, int *size, size_t size_elems,
+                     int limit, const char *what) {
+  void *newblock;
+  int newsize;
+  if (*size >= limit/2) {  /* cannot double it? */
+    if (*size >= limit)  /* cannot grow even a little? */
+      luaG_runerror(L, "too many %s (limit is %d)", what, limit);
+    newsize = limit;  /* still have at least one free place */
+  }
+  else {
+    newsize = (*size)*2;
+    if (newsize < MINSIZEARRAY)
+      newsize = MINSIZEARRAY;  /* minimum size */
+  }
+  newblock = luaM_reallocv(L, block, *size, newsize, size_elems);
+  *size = newsize;  /* update only when everything else is OK */
+  return newblock;
+}
+
+
+l_noret luaM_toobig (lua_State *L) {
+  luaG_runerror(L, "memory allocation error: block too big");
+}
+
+
+
+/*
+** Enforce the memory budget of the state before it grows by 'grow'
+** bytes. Crossing the soft limit puts the collector in debt, so that it
+** keeps working at the next safe point; crossing the hard limit gets an
+** emergency collection (unless they are stopped) and, if that is not
+** enough, a memory error.
+*/
+static void checkbudget (lua_State *L, size_t grow) {
+  global_State *g = G(L);
+  l_mem total = gettotalbytes(g) + cast(l_mem, grow);
+  if (total > g->hardlimit) {
+    if (!g->gcstopem)
+      luaC_fullgc(L, 1);  /* try to free some memory... */
+    if (gettotalbytes(g) + cast(l_mem, grow) > g->hardlimit)
+      luaD_throw(L, LUA_ERRMEM);
+  }
+  else if (total > g->softlimit && g->GCdebt <= 0 && g->gcrunning)
+    luaE_setdebt(g, 0);  /* next 'luaC_checkGC' will do a step */
+}
+
+
+/*
+** generic allocation routine. Growth is charged to the running thread,
+** which may have a quota of its own; what the collector allocates (in
+** finalizers too) is not, so a collection never fails in a thread for
+** its quota.
+*/
+void *luaM_realloc_ (lua_State *L, void *block, size_t osize, size_t nsize) {
+  void *newblock;
+  global_State *g = G(L);
+  size_t realosize = (block) ? osize : 0;
+  lua_assert((realosize == 0) == (block == NULL));
+#if defined(HARDMEMTESTS)
+  if (nsize > realosize && g->gcrunning && !g->gcstopem)
+    luaC_fullgc(L, 1);  /* force a GC whenever possible */
+#endif
+  if (nsize > realosize && g->version) {  /* growing a fully built state? */
+    if (L->allocquota && !g->gcinside &&
+        L->nalloc + (nsize - realosize) > L->allocquota)
+      luaD_throw(L, LUA_ERRMEM);  /* thread over its quota */
+    checkbudget(L, nsize - realosize);
+  }
+  if (nsize == 0 && g->gcsweepfree != SWEEPFREE_NOW && block != NULL) {
+    luaC_sweepfree(g, block, osize);  /* block of a swept object */
+    newblock = NULL;
+  }
+  else
+    newblock = callfrealloc(g, block, osize, nsize);
+  if (newblock == NULL && nsize > 0) {
+    lua_assert(nsize > realosize);  /* cannot fail when shrinking a block */
+    if (g->version && !g->gcstopem) {  /* can collect? */
+      luaC_fullgc(L, 1);  /* try to free some memory... */
+      newblock = callfrealloc(g, block, osize, nsize);  /* try again */
+    }
+    if (newblock == NULL)
+      luaD_throw(L, LUA_ERRMEM);
+  }
+  lua_assert((nsize == 0) == (newblock == NULL));
+  if (nsize > realosize && !g->gcinside)
+    L->nalloc += nsize - realosize;
+  g->GCdebt = (g->GCdebt + nsize) - realosize;
+  return newblock;
+}
+
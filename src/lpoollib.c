@@ -0,0 +1,100 @@
+/*
+** Memory pool library: statistics of the CMemPool behind the state
+** See Copyright Notice in lua.h
+*/
+
+#define lpoollib_c
+#define LUA_LIB
+
+#include "lprefix.h"
+
+
+#include "lua.h"
+
+#include "lauxlib.h"
+#include "lualib.h"
+
+#include "CmemPool.h"
+
+
+static const char *const arenanames[MEMPOOL_ARENA_NUM] = {
+  "other", "string", "table", "function", "userdata", "thread"
+};
+
+
+/*
+** The pool of the state: its 'ud' when the allocator is luaMemAlloc, else
+** the one a host registered under LUA_MEMPOOLKEY.
+*/
+static CMemPool *getpool (lua_State *L) {
+  void *ud;
+  CMemPool *pool = NULL;
+  if (lua_getallocf(L, &ud) == luaMemAlloc)
+    pool = (CMemPool *)ud;
+  else {
+    if (lua_getfield(L, LUA_REGISTRYINDEX, LUA_MEMPOOLKEY) == LUA_TLIGHTUSERDATA)
+      pool = (CMemPool *)lua_touserdata(L, -1);
+    lua_pop(L, 1);
+  }
+  return pool;
+}
+
+
+static void setfield (lua_State *L, const char *key, lua_Integer value) {
+  lua_pushinteger(L, value);
+  lua_setfield(L, -2, key);
+}
+
+
+static int pool_stats (lua_State *L) {
+  CMemPool *pool = getpool(L);
+  MemPoolStats stats;
+  unsigned long i;
+  if (pool == NULL) {
+    lua_pushnil(L);
+    lua_pushliteral(L, "state does not use a memory pool");
+    return 2;
+  }
+  luaMemStats(pool, &stats);
+  lua_createtable(L, 0, 12);
+  setfield(L, "live", (lua_Integer)stats.m_liveBytes);
+  setfield(L, "peak", (lua_Integer)stats.m_peakBytes);
+  setfield(L, "footprint", (lua_Integer)stats.m_footprint);
+  setfield(L, "peakfootprint", (lua_Integer)stats.m_peakFootprint);
+  setfield(L, "sysbytes", (lua_Integer)stats.m_sysBytes);
+  setfield(L, "unitbytes", (lua_Integer)stats.m_unitBytes);
+  setfield(L, "failed", (lua_Integer)stats.m_failedNum);
+  setfield(L, "fallback", (lua_Integer)stats.m_sysAllocNum);
+  lua_pushnumber(L, (lua_Number)stats.m_fragmentation);
+  lua_setfield(L, -2, "fragmentation");
+  lua_createtable(L, 0, MEMPOOL_ARENA_NUM);
+  for (i = 0; i < MEMPOOL_ARENA_NUM; i++)
+    setfield(L, arenanames[i], (lua_Integer)stats.m_arenaBytes[i]);
+  lua_setfield(L, -2, "arenas");
+  lua_createtable(L, (int)stats.m_classNum, 0);
+  for (i = 0; i < stats.m_classNum; i++) {
+    const MemPoolClassStats *cs = &stats.m_classes[i];
+    lua_createtable(L, 0, 5);
+    setfield(L, "size", (lua_Integer)cs->m_unitSize);
+    setfield(L, "slabs", (lua_Integer)cs->m_slabNum);
+    setfield(L, "used", (lua_Integer)cs->m_usedNum);
+    setfield(L, "freelist", (lua_Integer)cs->m_freeListNum);
+    setfield(L, "uncarved", (lua_Integer)cs->m_uncarvedNum);
+    lua_rawseti(L, -2, (lua_Integer)i + 1);
+  }
+  lua_setfield(L, -2, "classes");
+  return 1;
+}
+
+
+static const luaL_Reg pool_funcs[] = {
+  {"stats", pool_stats},
+  {NULL, NULL}
+};
+
+
+LUAMOD_API int luaopen_mempool (lua_State *L) {
+  luaL_newlib(L, pool_funcs);
+  return 1;
+}
+
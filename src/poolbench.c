@@ -0,0 +1,1273 @@
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "lstate.h"    /* sizeof(Table) and sizeof(CallInfo) for the aligned classes */
+#include "CmemPool.h"
+#include "arenaalloc.h"
+#include "bufferalloc.h"
+
+/*
+* Allocator benchmarks for CMemPool. Every workload runs a Lua chunk on a
+* fresh lua_State backed by the pool and reports what the allocator did.
+*/
+
+typedef struct BenchCounters
+{
+   CMemPool* m_pPool;
+   unsigned long long m_reallocs;       /* resizes of an existing block */
+   unsigned long long m_naiveCopied;    /* bytes the old luaReallocMem copied */
+}BenchCounters;
+
+static BenchCounters g_counters;
+
+static void *bench_lua_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
+{
+   BenchCounters* pCounters = (BenchCounters*)ud;
+
+   if (nsize == 0)
+   {
+      if (ptr != NULL)
+      {
+         luaReleaseMem(pCounters->m_pPool, ptr, osize);
+      }
+      return NULL;
+   }
+   if (ptr != NULL)
+   {
+      /* the old implementation always moved the block, copying 'nsize' bytes */
+      pCounters->m_reallocs++;
+      pCounters->m_naiveCopied += nsize;
+   }
+   return luaReallocMem(pCounters->m_pPool, ptr, osize, nsize);
+}
+
+static void bench_gc_cycle (void *ud)
+{
+   BenchCounters* pCounters = (BenchCounters*)ud;
+   luaTrimMem(pCounters->m_pPool);
+}
+
+static const lua_AllocHooks g_benchHooks = { bench_gc_cycle, NULL, NULL, NULL, NULL, NULL };
+
+static double now_ms (void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+typedef struct Workload
+{
+   const char* name;
+   const char* chunk;
+}Workload;
+
+static const Workload g_reallocWorkloads[] =
+{
+   { "array append",   "local t = {} for i = 1, 200000 do t[#t + 1] = i end" },
+   { "hash insert",    "local t = {} for i = 1, 50000 do t['k' .. i] = i end" },
+   { "deep recursion", "local function f(n) if n == 0 then return 0 end "
+                       "return 1 + f(n - 1) end for i = 1, 20 do f(5000) end" },
+   { "table churn",    "for i = 1, 20000 do local t = {} for j = 1, 40 do t[j] = j end end" },
+   { "compile",        "for i = 1, 200 do load(string.rep('local a = 1 + 2 ', 200)) end" },
+   { NULL, NULL }
+};
+
+static void bench_realloc (void)
+{
+   const Workload* w;
+
+   printf("%-16s %10s %16s %16s %10s\n",
+      "workload", "reallocs", "copied(before)", "copied(after)", "ms");
+
+   for (w = g_reallocWorkloads; w->name != NULL; w++)
+   {
+      lua_State* L;
+      double start;
+
+      memset(&g_counters, 0, sizeof(g_counters));
+      g_counters.m_pPool = luaCreateMem(8192, 2048);
+
+      start = now_ms();
+      L = lua_newstate(bench_lua_alloc, &g_counters);
+      luaL_openlibs(L);
+      if (luaL_dostring(L, w->chunk))
+      {
+         fprintf(stderr, "%s: %s\n", w->name, lua_tostring(L, -1));
+      }
+      lua_close(L);
+
+      printf("%-16s %10llu %16llu %16llu %10.2f\n", w->name, g_counters.m_reallocs,
+         g_counters.m_naiveCopied, luaMemBytesCopied(g_counters.m_pPool), now_ms() - start);
+
+      luaDestroyMem(g_counters.m_pPool);
+   }
+}
+
+/*
+* Resident pool memory across a load spike: footprint at the peak, after the
+* garbage is collected (empty slabs released by the GC hook) and after a
+* smaller second wave reuses the remaining slabs.
+*/
+static void bench_footprint (void)
+{
+   static const char* chunk =
+      "function wave(n) local t = {} for i = 1, n do t[i] = { i, 'x' .. i } end return t end\n"
+      "spike = wave(200000)\n";
+   lua_State* L;
+
+   memset(&g_counters, 0, sizeof(g_counters));
+   g_counters.m_pPool = luaCreateMem(512, 2048);
+   L = lua_newstate(bench_lua_alloc, &g_counters);
+   lua_setallochooks(L, &g_benchHooks);
+   luaL_openlibs(L);
+
+   if (luaL_dostring(L, chunk))
+   {
+      fprintf(stderr, "footprint: %s\n", lua_tostring(L, -1));
+   }
+   printf("%-24s %10lu KB\n", "footprint at peak", (unsigned long)(luaMemFootprint(g_counters.m_pPool) / 1024));
+
+   if (luaL_dostring(L, "spike = nil collectgarbage()"))
+   {
+      fprintf(stderr, "footprint: %s\n", lua_tostring(L, -1));
+   }
+   printf("%-24s %10lu KB\n", "after collection", (unsigned long)(luaMemFootprint(g_counters.m_pPool) / 1024));
+
+   if (luaL_dostring(L, "spike = wave(20000) collectgarbage()"))
+   {
+      fprintf(stderr, "footprint: %s\n", lua_tostring(L, -1));
+   }
+   printf("%-24s %10lu KB\n", "after small wave", (unsigned long)(luaMemFootprint(g_counters.m_pPool) / 1024));
+   printf("%-24s %10lu KB\n", "  of which tables", (unsigned long)(luaMemArenaFootprint(g_counters.m_pPool, MEMPOOL_ARENA_TABLE) / 1024));
+   printf("%-24s %10lu KB\n", "  of which strings", (unsigned long)(luaMemArenaFootprint(g_counters.m_pPool, MEMPOOL_ARENA_STRING) / 1024));
+
+   lua_close(L);
+   luaDestroyMem(g_counters.m_pPool);
+}
+
+/*
+* An object mix of tables, closures and strings, with the pool in its default
+* layout (units packed 16 bytes apart) and with the Table and CallInfo classes
+* aligned on cache lines.
+*/
+static void bench_align (void)
+{
+   static const char* chunk =
+      "local objs = {} for i = 1, 100000 do local n = i "
+      "objs[i] = { function () return n end, 'o' .. i, { n } } end";
+   int aligned;
+
+   printf("%-24s %10s %10s\n", "layout", "peak KB", "ms");
+
+   for (aligned = 0; aligned < 2; aligned++)
+   {
+      lua_State* L;
+      size_t peak;
+      double start;
+
+      memset(&g_counters, 0, sizeof(g_counters));
+      g_counters.m_pPool = luaCreateMem(0, 2048);
+      if (aligned)
+      {
+         luaMemAlignClass(g_counters.m_pPool, sizeof(Table));
+         luaMemAlignClass(g_counters.m_pPool, sizeof(CallInfo));
+      }
+
+      start = now_ms();
+      L = lua_newstate(bench_lua_alloc, &g_counters);
+      luaL_openlibs(L);
+      if (luaL_dostring(L, chunk))
+      {
+         fprintf(stderr, "align: %s\n", lua_tostring(L, -1));
+      }
+      peak = luaMemFootprint(g_counters.m_pPool);
+      lua_close(L);
+
+      printf("%-24s %10lu %10.2f\n", aligned ? "Table/CallInfo aligned" : "packed",
+         (unsigned long)(peak / 1024), now_ms() - start);
+      luaDestroyMem(g_counters.m_pPool);
+   }
+}
+
+/*
+* Many isolated states, each on its own pool. Tearing a state down with
+* lua_close frees every object; destroying only its pool frees the slabs.
+*/
+static void bench_states (void)
+{
+   enum { STATE_NUM = 200 };
+   static const char* chunk =
+      "objs = {} for i = 1, 5000 do objs[i] = { name = 'obj' .. i, i } end";
+   CMemPool* pools[STATE_NUM];
+   lua_State* states[STATE_NUM];
+   int pass;
+
+   for (pass = 0; pass < 2; pass++)
+   {
+      double start;
+      int i;
+
+      for (i = 0; i < STATE_NUM; i++)
+      {
+         pools[i] = luaCreateMem(0, 2048);
+         states[i] = lua_newstate(luaMemAlloc, pools[i]);
+         luaL_openlibs(states[i]);
+         if (luaL_dostring(states[i], chunk))
+         {
+            fprintf(stderr, "states: %s\n", lua_tostring(states[i], -1));
+         }
+      }
+
+      start = now_ms();
+      for (i = 0; i < STATE_NUM; i++)
+      {
+         if (pass == 0)
+         {
+            lua_close(states[i]);
+         }
+         luaDestroyMem(pools[i]);   /* frees the memory of an unclosed state too */
+      }
+      printf("%-24s %10.2f ms for %d states\n",
+         pass == 0 ? "lua_close + destroy" : "destroy pool only", now_ms() - start, STATE_NUM);
+   }
+}
+
+/*
+* One short script per request, each on a new lua_State: a new pool per
+* request, and one arena reused by all requests and emptied by lua_close.
+*/
+static const lua_AllocHooks g_arenaHooks = { NULL, luaArenaFreeAll, NULL, NULL, NULL, NULL };
+
+static void bench_requests (void)
+{
+   enum { REQUEST_NUM = 2000 };
+   static const char* chunk =
+      "local out = {} for i = 1, 300 do out[#out + 1] = string.format('%d=%s', i, 'v' .. i) end "
+      "return table.concat(out, ',')";
+   LuaArena* arena = luaCreateArena(0);
+   int mode;
+
+   for (mode = 0; mode < 2; mode++)
+   {
+      double start = now_ms();
+      int i;
+
+      for (i = 0; i < REQUEST_NUM; i++)
+      {
+         CMemPool* pPool = NULL;
+         lua_State* L;
+
+         if (mode == 0)
+         {
+            pPool = luaCreateMem(0, 2048);
+            L = lua_newstate(luaMemAlloc, pPool);
+         }
+         else
+         {
+            L = lua_newstate(luaArenaAlloc, arena);
+            lua_setallochooks(L, &g_arenaHooks);
+         }
+         luaL_openlibs(L);
+         if (luaL_dostring(L, chunk))
+         {
+            fprintf(stderr, "requests: %s\n", lua_tostring(L, -1));
+         }
+         lua_close(L);
+         if (pPool != NULL)
+         {
+            luaDestroyMem(pPool);
+         }
+      }
+      printf("%-24s %10.2f ms for %d requests\n",
+         mode == 0 ? "pool per request" : "reused arena", now_ms() - start, REQUEST_NUM);
+   }
+   printf("%-24s %10lu KB (%lu KB reserved)\n", "arena high watermark",
+      (unsigned long)(luaArenaHighWater(arena) / 1024), (unsigned long)(luaArenaReserved(arena) / 1024));
+   luaDestroyArena(arena);
+}
+
+/*
+* CMemPool against the slab-per-class buffer allocator: the foo.lua script of
+* the demo host, loaded and called on a new state per run, and a table-heavy
+* chunk. Memory is the pool footprint and the slab bytes carved at the end of
+* the chunk; blocks the buffer allocator sent to malloc are counted apart.
+*/
+static int bench_doubler (lua_State* L)
+{
+   lua_pushinteger(L, luaL_checkinteger(L, 1) * 2);
+   return 1;
+}
+
+static int bench_register (lua_State* L)
+{
+   (void)L;
+   return 0;
+}
+
+static const char* bench_foo_chunk (lua_State* L)
+{
+   lua_register(L, "mydoubler", bench_doubler);
+   lua_register(L, "registerButonClick", bench_register);
+   if (luaL_dofile(L, "foo.lua"))
+   {
+      return lua_tostring(L, -1);
+   }
+   lua_getglobal(L, "lua_fun");
+   lua_pushinteger(L, 3);
+   lua_pushinteger(L, 4);
+   return lua_pcall(L, 2, 1, 0) ? lua_tostring(L, -1) : NULL;
+}
+
+static const char* bench_table_chunk (lua_State* L)
+{
+   static const char* chunk =
+      "local rows = {} for i = 1, 200000 do rows[i] = { id = i, name = 'r' .. i, { i } } end "
+      "rows = nil collectgarbage() "
+      "for r = 1, 50 do local t = {} for i = 1, 2000 do t[i] = { i, i } end end";
+   return luaL_dostring(L, chunk) ? lua_tostring(L, -1) : NULL;
+}
+
+static void bench_buffer (void)
+{
+   static const struct
+   {
+      const char* name;
+      const char* (*run)(lua_State* L);
+      int runs;
+   } workloads[] = { { "foo.lua", bench_foo_chunk, 2000 }, { "table heavy", bench_table_chunk, 1 } };
+   int w, mode;
+
+   printf("%-12s %-8s %10s %10s %10s\n", "workload", "alloc", "ms", "KB", "to malloc");
+
+   for (w = 0; w < 2; w++)
+   {
+      for (mode = 0; mode < 2; mode++)
+      {
+         double start = now_ms();
+         size_t bytes = 0, overflow = 0;
+         int i;
+
+         for (i = 0; i < workloads[w].runs; i++)
+         {
+            CMemPool* pPool = NULL;
+            LuaBufferAllocator* pBuffers = NULL;
+            const char* error;
+            lua_State* L;
+
+            if (mode == 0)
+            {
+               pPool = luaCreateMem(0, 2048);
+               L = lua_newstate(luaMemAlloc, pPool);
+            }
+            else
+            {
+               pBuffers = luaCreateBufferAllocator(0, 8192);
+               L = lua_newstate(luaBufferAlloc, pBuffers);
+            }
+            luaL_openlibs(L);
+            error = workloads[w].run(L);
+            if (error != NULL)
+            {
+               fprintf(stderr, "buffer: %s\n", error);
+            }
+            bytes = (mode == 0) ? luaMemFootprint(pPool) : luaBufferAllocCarved(pBuffers);
+            lua_close(L);
+            if (mode == 0)
+            {
+               luaDestroyMem(pPool);
+            }
+            else
+            {
+               overflow += luaBufferAllocOverflow(pBuffers);
+               luaReleaseBufferAllocator(pBuffers);
+            }
+         }
+         printf("%-12s %-8s %10.2f %10lu %10lu\n", workloads[w].name, mode == 0 ? "pool" : "buffer",
+            now_ms() - start, (unsigned long)(bytes / 1024), (unsigned long)overflow);
+      }
+   }
+}
+
+/*
+* Slabs mapped one by one against slabs carved from 2 MB regions, prefaulted
+* and/or on transparent huge pages. The first request on a new state shows the
+* page faults the prefault took ahead of time; the following requests, on the
+* warm pool, show the dTLB misses huge pages save on a table-heavy script.
+*/
+static int tlb_open (void)
+{
+#if defined(__linux__)
+   struct perf_event_attr attr;
+
+   memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.type = PERF_TYPE_HW_CACHE;
+   attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+   return -1;
+#endif
+}
+
+static long long tlb_read (int fd)
+{
+   long long n;
+   return (fd >= 0 && read(fd, &n, sizeof(n)) == sizeof(n)) ? n : -1;
+}
+
+static long minor_faults (void)
+{
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_minflt;
+}
+
+static void bench_hugepage (void)
+{
+   enum { STEADY_RUNS = 5, PREFAULT_BYTES = 96 * 1024 * 1024 };
+   static const char* chunk =
+      "local rows = {} for i = 1, 150000 do rows[i] = { id = i, name = 'r' .. i, { i } } end "
+      "local s = 0 for r = 1, 10 do for i = 1, #rows, 3 do s = s + rows[i].id + rows[i][1][1] end end "
+      "return s";
+   static const struct
+   {
+      const char* name;
+      int flags;
+   } modes[] = {
+      { "slabs",             MEMPOOL_MAP_SLABS },
+      { "regions prefault",  MEMPOOL_MAP_POPULATE },
+      { "huge pages",        MEMPOOL_MAP_HUGEPAGE },
+      { "huge + prefault",   MEMPOOL_MAP_HUGEPAGE | MEMPOOL_MAP_POPULATE }
+   };
+   int fd = tlb_open();
+   int m;
+
+   printf("%-18s %10s %10s %10s %14s\n", "mapping", "first ms", "faults", "steady ms", "dTLB misses");
+
+   for (m = 0; m < 4; m++)
+   {
+      CMemPool* pPool = luaCreateMem(0, 2048);
+      lua_State* L;
+      long faults;
+      long long misses;
+      double start, first;
+      int i;
+
+      luaSetMemMapping(pPool, modes[m].flags);
+      if (modes[m].flags & MEMPOOL_MAP_POPULATE)
+      {
+         luaMemPrefault(pPool, PREFAULT_BYTES);   /* the worker warms up before traffic */
+      }
+
+      faults = minor_faults();
+      start = now_ms();
+      L = lua_newstate(luaMemAlloc, pPool);
+      luaL_openlibs(L);
+      if (luaL_dostring(L, chunk))
+      {
+         fprintf(stderr, "hugepage: %s\n", lua_tostring(L, -1));
+      }
+      lua_settop(L, 0);
+      first = now_ms() - start;
+      faults = minor_faults() - faults;
+
+      misses = tlb_read(fd);
+      start = now_ms();
+      for (i = 0; i < STEADY_RUNS; i++)
+      {
+         if (luaL_dostring(L, chunk))
+         {
+            fprintf(stderr, "hugepage: %s\n", lua_tostring(L, -1));
+         }
+         lua_settop(L, 0);
+      }
+      printf("%-18s %10.2f %10ld %10.2f ", modes[m].name, first, faults, (now_ms() - start) / STEADY_RUNS);
+      if (fd >= 0)
+      {
+         printf("%14lld\n", (tlb_read(fd) - misses) / STEADY_RUNS);
+      }
+      else
+      {
+         printf("%14s\n", "n/a");
+      }
+      lua_close(L);
+      luaDestroyMem(pPool);
+   }
+   if (fd >= 0)
+   {
+      close(fd);
+   }
+}
+
+/*
+* A long-lived set of tables plus churn, on a pool with an upper bound: tight
+* (a little above what the script needs) and roomy. The collector paces itself
+* on its pause alone, then also on the pressure the pool reports. Failed
+* allocations are the emergency collections the bound forced.
+*/
+typedef struct PressureCounters
+{
+   CMemPool* m_pPool;
+   unsigned long m_cycles;
+}PressureCounters;
+
+static void pressure_gc_cycle (void *ud)
+{
+   PressureCounters* pCounters = (PressureCounters*)ud;
+   pCounters->m_cycles++;
+   luaTrimMem(pCounters->m_pPool);
+}
+
+static int pressure_hook (void *ud)
+{
+   return luaMemPressure(((PressureCounters*)ud)->m_pPool);
+}
+
+static void *pressure_lua_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
+{
+   return luaMemAlloc(((PressureCounters*)ud)->m_pPool, ptr, osize, nsize);
+}
+
+static const lua_AllocHooks g_pauseHooks = { pressure_gc_cycle, NULL, NULL, NULL, NULL, NULL };
+static const lua_AllocHooks g_pressureHooks = { pressure_gc_cycle, NULL, pressure_hook, NULL, NULL, NULL };
+
+static void bench_pressure (void)
+{
+   static const char* chunk =
+      "keep = {} for i = 1, 60000 do keep[i] = { i, 'k' .. i } end "
+      "for r = 1, 60 do local t = {} for i = 1, 20000 do t[i] = { i, i } end end";
+   static const size_t bounds[] = { 16 * 1024 * 1024, 256 * 1024 * 1024 };
+   int b, paced;
+
+   printf("%-8s %-10s %8s %10s %10s %10s\n", "bound", "pacing", "cycles", "emergency", "peak KB", "ms");
+
+   for (b = 0; b < 2; b++)
+   {
+      for (paced = 0; paced < 2; paced++)
+      {
+         PressureCounters counters;
+         MemPoolStats stats;
+         lua_State* L;
+         double start;
+
+         counters.m_pPool = luaCreateMem(0, 2048);
+         counters.m_cycles = 0;
+         luaSetMemGrowth(counters.m_pPool, MEMPOOL_GROW_GEOMETRIC, 8, bounds[b]);
+
+         start = now_ms();
+         L = lua_newstate(pressure_lua_alloc, &counters);
+         lua_setallochooks(L, paced ? &g_pressureHooks : &g_pauseHooks);
+         luaL_openlibs(L);
+         if (luaL_dostring(L, chunk))
+         {
+            fprintf(stderr, "pressure: %s\n", lua_tostring(L, -1));
+         }
+         luaMemStats(counters.m_pPool, &stats);
+         printf("%-8s %-10s %8lu %10llu %10lu %10.2f\n", b == 0 ? "tight" : "roomy", paced ? "pressure" : "pause",
+            counters.m_cycles, stats.m_failedNum, (unsigned long)(stats.m_peakFootprint / 1024), now_ms() - start);
+         lua_close(L);
+         luaDestroyMem(counters.m_pPool);
+      }
+   }
+}
+
+/*
+* Several threads, each running its own lua_State, sharing one pool. The
+* shared pool (per-thread magazines) is compared with a single-threaded pool
+* behind one global mutex.
+*/
+typedef struct ThreadArg
+{
+   CMemPool* m_pPool;
+   pthread_mutex_t* m_pLock;            /* NULL for the shared pool */
+   unsigned long long m_allocs;
+}ThreadArg;
+
+static void *thread_lua_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
+{
+   ThreadArg* pArg = (ThreadArg*)ud;
+   void* result;
+
+   if (pArg->m_pLock != NULL)
+   {
+      pthread_mutex_lock(pArg->m_pLock);
+   }
+   if (nsize == 0)
+   {
+      if (ptr != NULL)
+      {
+         luaReleaseMem(pArg->m_pPool, ptr, osize);
+      }
+      result = NULL;
+   }
+   else
+   {
+      pArg->m_allocs++;
+      result = luaReallocMem(pArg->m_pPool, ptr, osize, nsize);
+   }
+   if (pArg->m_pLock != NULL)
+   {
+      pthread_mutex_unlock(pArg->m_pLock);
+   }
+   return result;
+}
+
+static void *thread_main (void *arg)
+{
+   static const char* chunk =
+      "for i = 1, 30 do local t = {} for j = 1, 2000 do t[j] = { j, tostring(j) } end end";
+   ThreadArg* pArg = (ThreadArg*)arg;
+   lua_State* L = lua_newstate(thread_lua_alloc, pArg);
+
+   luaL_openlibs(L);
+   if (luaL_dostring(L, chunk))
+   {
+      fprintf(stderr, "threads: %s\n", lua_tostring(L, -1));
+   }
+   lua_close(L);
+   return NULL;
+}
+
+static void bench_threads (void)
+{
+   enum { MAX_THREADS = 16 };
+   long cores = sysconf(_SC_NPROCESSORS_ONLN);
+   int threadNum;
+   int mode;
+
+   printf("%-14s %8s %14s %16s\n", "pool", "threads", "Mallocs/s", "Mallocs/s/thread");
+
+   for (mode = 0; mode < 2; mode++)
+   {
+      for (threadNum = 1; threadNum <= MAX_THREADS && threadNum <= 2 * cores; threadNum *= 2)
+      {
+         pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+         pthread_t threads[MAX_THREADS];
+         ThreadArg args[MAX_THREADS];
+         CMemPool* pPool = (mode == 0) ? luaCreateSharedMem(0, 2048) : luaCreateMem(0, 2048);
+         unsigned long long allocs = 0;
+         double start, secs;
+         int i;
+
+         start = now_ms();
+         for (i = 0; i < threadNum; i++)
+         {
+            args[i].m_pPool = pPool;
+            args[i].m_pLock = (mode == 0) ? NULL : &lock;
+            args[i].m_allocs = 0;
+            pthread_create(&threads[i], NULL, thread_main, &args[i]);
+         }
+         for (i = 0; i < threadNum; i++)
+         {
+            pthread_join(threads[i], NULL);
+            allocs += args[i].m_allocs;
+         }
+         secs = (now_ms() - start) / 1e3;
+
+         printf("%-14s %8d %14.2f %16.2f\n", (mode == 0) ? "shared" : "global mutex",
+            threadNum, allocs / secs / 1e6, allocs / secs / 1e6 / threadNum);
+         luaDestroyMem(pPool);
+      }
+   }
+}
+
+/*
+* A traffic burst leaves big tables emptied but not shrunk, deep coroutine
+* stacks and a large string table behind. collectgarbage("collect") only
+* frees the garbage; collectgarbage("trim") shrinks the stacks and the
+* string table that survive and gives every empty slab back.
+*/
+static const lua_AllocHooks g_trimHooks = { luaMemGCCycle, NULL, NULL, luaMemTrimAll, NULL, NULL };
+
+static void bench_trim (void)
+{
+   static const char* chunk =
+      "cache = {} for i = 1, 200000 do cache['k' .. i] = { i } end\n"
+      "list = {} for i = 1, 200000 do list[i] = i end\n"
+      "local function deep(n) if n > 0 then return deep(n - 1) + 1 end coroutine.yield() return 0 end\n"
+      "cos = {} for i = 1, 50 do cos[i] = coroutine.create(deep) coroutine.resume(cos[i], 2000) end\n"
+      "for k in pairs(cache) do cache[k] = nil end\n"
+      "for i = 1, #list do list[i] = nil end\n";
+   static const char* steps[] = { "collectgarbage('collect')", "collectgarbage('trim')" };
+   static const struct { const char* name; int flags; } modes[] =
+   {
+      { "slabs",   MEMPOOL_MAP_SLABS },
+      { "regions", MEMPOOL_MAP_HUGEPAGE }       /* spare slabs purged, not unmapped */
+   };
+   int m;
+
+   printf("%-10s %-26s %10s %10s %10s\n", "mapping", "after", "lua KB", "pool KB", "ms");
+   for (m = 0; m < 2; m++)
+   {
+      CMemPool* pPool = luaCreateMem(0, 2048);
+      lua_State* L;
+      int i;
+
+      luaSetMemMapping(pPool, modes[m].flags);
+      L = lua_newstate(luaMemAlloc, pPool);
+      lua_setallochooks(L, &g_trimHooks);
+      luaL_openlibs(L);
+      if (luaL_dostring(L, chunk))
+      {
+         fprintf(stderr, "trim: %s\n", lua_tostring(L, -1));
+      }
+      printf("%-10s %-26s %10d %10lu %10s\n", modes[m].name, "burst", lua_gc(L, LUA_GCCOUNT, 0),
+         (unsigned long)(luaMemFootprint(pPool) / 1024), "");
+      for (i = 0; i < 2; i++)
+      {
+         double start = now_ms();
+
+         if (luaL_dostring(L, steps[i]))
+         {
+            fprintf(stderr, "trim: %s\n", lua_tostring(L, -1));
+         }
+         printf("%-10s %-26s %10d %10lu %10.2f\n", modes[m].name, steps[i], lua_gc(L, LUA_GCCOUNT, 0),
+            (unsigned long)(luaMemFootprint(pPool) / 1024), now_ms() - start);
+      }
+      lua_close(L);
+      luaDestroyMem(pPool);
+   }
+}
+
+/*
+* One coroutine per request, every one with an allocation quota: a runaway
+* request (each 50th here) gets a memory error in its own coroutine while the
+* VM and the other requests go on.
+*/
+static void bench_corolimit (void)
+{
+   static const char* chunk =
+      "local function handle(id)\n"
+      "   local n = (id % 50 == 0) and 1e7 or 200\n"
+      "   local t = {} for i = 1, n do t[i] = { id = id, name = 'r' .. i } end\n"
+      "   return #t\n"
+      "end\n"
+      "local done, killed, bytes = 0, 0, 0\n"
+      "for id = 1, 1000 do\n"
+      "   local co = coroutine.create(handle)\n"
+      "   coroutine.setallocquota(co, 4 * 1024 * 1024)\n"
+      "   local ok = coroutine.resume(co, id)\n"
+      "   if ok then done = done + 1 else killed = killed + 1 end\n"
+      "   bytes = bytes + coroutine.allocated(co)\n"
+      "end\n"
+      "return done, killed, bytes // 1000\n";
+   CMemPool* pPool = luaCreateMem(0, 2048);
+   lua_State* L = lua_newstate(luaMemAlloc, pPool);
+   double start;
+
+   luaL_openlibs(L);
+   start = now_ms();
+   if (luaL_dostring(L, chunk))
+   {
+      fprintf(stderr, "corolimit: %s\n", lua_tostring(L, -1));
+   }
+   else
+   {
+      printf("%-24s %10d\n", "requests done", (int)lua_tointeger(L, -3));
+      printf("%-24s %10d\n", "requests over quota", (int)lua_tointeger(L, -2));
+      printf("%-24s %10d\n", "bytes per request", (int)lua_tointeger(L, -1));
+      printf("%-24s %10lu KB\n", "pool footprint", (unsigned long)(luaMemFootprint(pPool) / 1024));
+      printf("%-24s %10.2f ms\n", "time", now_ms() - start);
+   }
+   lua_close(L);
+   luaDestroyMem(pPool);
+}
+
+/*
+* A large long-lived heap with a stream of short-lived temporaries, the case
+* generational mode is for: an incremental cycle re-marks the whole old heap,
+* a minor collection only the young objects and the touched old ones.
+*/
+#define GEN_ITERATIONS 2000
+
+static void bench_gen (void)
+{
+   static const char* setup =
+      "old = {} for i = 1, 300000 do old[i] = { id = i, name = 'o' .. i } end\n"
+      "function work(n)\n"
+      "   local t = {}\n"
+      "   for i = 1, 2000 do t[i] = { n, i, tostring(i) } end\n"
+      "   old[n % #old + 1].last = t[1]\n"
+      "   return #t\n"
+      "end\n";
+   static const char* modes[] = { "incremental", "generational" };
+   int m;
+
+   printf("%-18s %10s %10s %10s\n", "mode", "total ms", "max ms", "peak KB");
+   for (m = 0; m < 2; m++)
+   {
+      CMemPool* pPool = luaCreateMem(0, 2048);
+      lua_State* L = lua_newstate(luaMemAlloc, pPool);
+      double start, worst = 0;
+      int peak = 0, i;
+
+      luaL_openlibs(L);
+      if (luaL_dostring(L, setup))
+      {
+         fprintf(stderr, "gen: %s\n", lua_tostring(L, -1));
+      }
+      lua_gc(L, m == 0 ? LUA_GCINC : LUA_GCGEN, 0);
+      start = now_ms();
+      for (i = 0; i < GEN_ITERATIONS; i++)
+      {
+         double t0 = now_ms(), t1;
+
+         lua_getglobal(L, "work");
+         lua_pushinteger(L, i);
+         if (lua_pcall(L, 1, 0, 0))
+         {
+            fprintf(stderr, "gen: %s\n", lua_tostring(L, -1));
+            break;
+         }
+         t1 = now_ms() - t0;
+         if (t1 > worst)
+         {
+            worst = t1;
+         }
+         if (lua_gc(L, LUA_GCCOUNT, 0) > peak)
+         {
+            peak = lua_gc(L, LUA_GCCOUNT, 0);
+         }
+      }
+      printf("%-18s %10.2f %10.2f %10d\n", modes[m], now_ms() - start, worst, peak);
+      lua_close(L);
+      luaDestroyMem(pPool);
+   }
+}
+
+/*
+* Collector driven from idle time, as an event loop would: the automatic
+* collector is stopped and each tick ends with either a debt-sized step
+* (LUA_GCSTEP) or a time-budgeted one (LUA_GCSTEPUS). The heap mixes small
+* tables, strings and a few large tables, so debt units map badly to time.
+*/
+#define STEPUS_TICKS 3000
+#define STEPUS_BUDGET 200
+
+static void bench_stepus (void)
+{
+   static const char* setup =
+      "small = {} for i = 1, 200000 do small[i] = { i, 's' .. i } end\n"
+      "big = {} for i = 1, 8 do local t = {} for j = 1, 100000 do t[j] = {} end big[i] = t end\n"
+      "function tick(n)\n"
+      "   local t = {}\n"
+      "   for i = 1, 500 do t[i] = { n, i, 'tmp' .. i } end\n"
+      "   small[n % #small + 1] = t[1]\n"
+      "end\n";
+   static const char* modes[] = { "step 64 KB", "stepus 200" };
+   int m;
+
+   printf("%-18s %10s %10s %10s %10s %10s\n", "driver", "cycles", "mean us", "max us", "over", "peak KB");
+   for (m = 0; m < 2; m++)
+   {
+      CMemPool* pPool = luaCreateMem(0, 2048);
+      lua_State* L = lua_newstate(luaMemAlloc, pPool);
+      double total = 0, worst = 0;
+      int cycles = 0, over = 0, peak = 0, i;
+
+      luaL_openlibs(L);
+      if (luaL_dostring(L, setup))
+      {
+         fprintf(stderr, "stepus: %s\n", lua_tostring(L, -1));
+      }
+      lua_gc(L, LUA_GCSTOP, 0);
+      for (i = 0; i < STEPUS_TICKS; i++)
+      {
+         double start, us;
+
+         lua_getglobal(L, "tick");
+         lua_pushinteger(L, i);
+         if (lua_pcall(L, 1, 0, 0))
+         {
+            fprintf(stderr, "stepus: %s\n", lua_tostring(L, -1));
+            break;
+         }
+         start = now_ms();
+         cycles += (m == 0) ? lua_gc(L, LUA_GCSTEP, 64) : lua_gc(L, LUA_GCSTEPUS, STEPUS_BUDGET);
+         us = (now_ms() - start) * 1e3;
+         total += us;
+         if (us > worst)
+         {
+            worst = us;
+         }
+         if (us > 2 * STEPUS_BUDGET)
+         {
+            over++;
+         }
+         if (lua_gc(L, LUA_GCCOUNT, 0) > peak)
+         {
+            peak = lua_gc(L, LUA_GCCOUNT, 0);
+         }
+      }
+      printf("%-18s %10d %10.1f %10.1f %10d %10d\n", modes[m], cycles, total / STEPUS_TICKS, worst, over, peak);
+      lua_close(L);
+      luaDestroyMem(pPool);
+   }
+}
+
+/*
+* A full collection that finds most of the heap dead, on a shared pool: the
+* thread running Lua frees every dead block itself, or only unlinks it and
+* queues it for the free thread (luaSetMemAsyncFree). The drain is the time
+* the free thread still needed after the collection returned.
+*/
+static const lua_AllocHooks g_asyncHooks = { luaMemGCCycle, NULL, NULL, luaMemTrimAll, luaMemFreeAsync, NULL };
+
+static void bench_asyncfree (void)
+{
+   static const char* chunks[] =
+   {
+      "keep = {} for i = 1, 100000 do keep[i] = { i } end\n"
+      "local junk = {} for i = 1, 1000000 do junk[i] = { i, 'j' .. i } end\n",
+      "keep = {} for i = 1, 100000 do keep[i] = { i } end\n"
+      "local junk = {} for i = 1, 20000 do local t = {} for j = 1, 1000 do t[j] = j end junk[i] = t end\n"
+   };
+   static const char* heaps[] = { "1M small tables", "20k arrays" };
+   static const char* modes[] = { "free on sweep", "free thread" };
+   int h, m;
+
+   printf("%-18s %-16s %10s %10s %10s\n", "heap", "mode", "collect ms", "drain ms", "pool KB");
+   for (h = 0; h < 2; h++)
+   {
+      for (m = 0; m < 2; m++)
+      {
+         CMemPool* pPool = luaCreateSharedMem(0, 2048);
+         lua_State* L = lua_newstate(luaMemAlloc, pPool);
+         double start, collect;
+
+         lua_setallochooks(L, &g_asyncHooks);
+         luaL_openlibs(L);
+         lua_gc(L, LUA_GCSTOP, 0);
+         if (luaL_dostring(L, chunks[h]))
+         {
+            fprintf(stderr, "asyncfree: %s\n", lua_tostring(L, -1));
+         }
+         if (m == 1 && !luaSetMemAsyncFree(pPool, 1))
+         {
+            fprintf(stderr, "asyncfree: no free thread\n");
+         }
+         start = now_ms();
+         lua_gc(L, LUA_GCCOLLECT, 0);
+         collect = now_ms() - start;
+         luaDrainMem(pPool);
+         printf("%-18s %-16s %10.2f %10.2f %10lu\n", heaps[h], modes[m], collect, now_ms() - start - collect,
+            (unsigned long)(luaMemFootprint(pPool) / 1024));
+         lua_close(L);
+         luaDestroyMem(pPool);
+      }
+   }
+}
+
+/*
+* Sweep of a heap of 1M dead small tables on a per-state pool, the dead
+* blocks freed one lua_Alloc call at a time or handed over in batches of
+* LUAI_FREEBATCH (the freebatch hook). Almost nothing is left to mark, so
+* the collection is the sweep.
+*/
+static const lua_AllocHooks g_batchHooks[] =
+{
+   { luaMemGCCycle, NULL, NULL, luaMemTrimAll, NULL, NULL },
+   { luaMemGCCycle, NULL, NULL, luaMemTrimAll, NULL, luaMemFreeBatch }
+};
+
+static void bench_freebatch (void)
+{
+   static const char* chunk =
+      "local junk = {} for i = 1, 1000000 do junk[i] = { i } end\n";
+   static const char* modes[] = { "one call a block", "freebatch" };
+   double best[2] = { 0, 0 };
+   int run, m;
+
+   for (run = 0; run < 5; run++)
+   {
+      for (m = 0; m < 2; m++)
+      {
+         CMemPool* pPool = luaCreateMem(0, 2048);
+         lua_State* L = lua_newstate(luaMemAlloc, pPool);
+         double start;
+
+         lua_setallochooks(L, &g_batchHooks[m]);
+         luaL_openlibs(L);
+         lua_gc(L, LUA_GCSTOP, 0);
+         if (luaL_dostring(L, chunk))
+         {
+            fprintf(stderr, "freebatch: %s\n", lua_tostring(L, -1));
+         }
+         start = now_ms();
+         lua_gc(L, LUA_GCCOLLECT, 0);
+         if (run == 0 || now_ms() - start < best[m])
+         {
+            best[m] = now_ms() - start;
+         }
+         lua_close(L);
+         luaDestroyMem(pPool);
+      }
+   }
+   printf("%-18s %10s\n", "frees", "best ms");
+   for (m = 0; m < 2; m++)
+   {
+      printf("%-18s %10.2f\n", modes[m], best[m]);
+   }
+}
+
+/*
+* Interns millions of distinct short strings with the collector stopped and
+* times every call: the ones that grow the string table used to rehash it
+* whole. The stall is the slowest single call; "grows" counts the calls that
+* changed the table size.
+*/
+#define STRTAB_COUNT 4000000
+
+static void bench_strtab (void)
+{
+   CMemPool* pPool = luaCreateMem(0, 2048);
+   lua_State* L = lua_newstate(luaMemAlloc, pPool);
+   double start = now_ms(), worst = 0, grow = 0;
+   int grows = 0, slow = 0, i;
+
+   lua_gc(L, LUA_GCSTOP, 0);
+   for (i = 0; i < STRTAB_COUNT; i++)
+   {
+      char key[32];
+      int size = G(L)->strt.size, len;
+      double t0, us;
+
+      len = snprintf(key, sizeof(key), "key:%d", i);
+      t0 = now_ms();
+      lua_pushlstring(L, key, len);
+      us = (now_ms() - t0) * 1e3;
+      lua_pop(L, 1);
+      if (us > worst)
+      {
+         worst = us;
+      }
+      if (us > 100)
+      {
+         slow++;
+      }
+      if (G(L)->strt.size != size)
+      {
+         grows++;
+         if (us > grow)
+         {
+            grow = us;
+         }
+      }
+   }
+   printf("%-10s %10s %10s %10s %12s %12s %10s\n", "strings", "grows", "total ms", "max us", "max grow us", "calls>100us", "buckets");
+   printf("%-10d %10d %10.1f %10.1f %12.1f %12d %10d\n", STRTAB_COUNT, grows, now_ms() - start, worst, grow, slow, G(L)->strt.size);
+   lua_close(L);
+   luaDestroyMem(pPool);
+}
+
+/*
+* Interning as a parser sees it: a working set of field names looked up over
+* and over (hits), then values seen once that die young (misses). Build with
+* MYCFLAGS=-DLUAI_STROPEN for the open-addressing string table.
+*/
+#define INTERN_KEYS 500000
+#define INTERN_HITS 20000000
+#define INTERN_MISSES 4000000
+
+static void bench_intern (void)
+{
+   char (*keys)[16] = malloc(INTERN_KEYS * sizeof(*keys));
+   unsigned int seed = 12345;
+   CMemPool* pPool;
+   lua_State* L;
+   double start, hits, misses;
+   int i;
+
+   if (keys == NULL)
+   {
+      fprintf(stderr, "intern: not enough memory for the keys\n");
+      return;
+   }
+   pPool = luaCreateMem(0, 2048);
+   L = lua_newstate(luaMemAlloc, pPool);
+   lua_createtable(L, INTERN_KEYS, 0);   /* keeps the working set alive */
+   for (i = 0; i < INTERN_KEYS; i++)
+   {
+      snprintf(keys[i], sizeof(keys[i]), "field_%d", i);
+      lua_pushstring(L, keys[i]);
+      lua_rawseti(L, -2, i + 1);
+   }
+   start = now_ms();
+   for (i = 0; i < INTERN_HITS; i++)
+   {
+      const char* key;
+
+      seed = seed * 1103515245u + 12345u;
+      key = keys[(seed >> 8) % INTERN_KEYS];
+      lua_pushlstring(L, key, strlen(key));
+      lua_pop(L, 1);
+   }
+   hits = now_ms() - start;
+   start = now_ms();
+   for (i = 0; i < INTERN_MISSES; i++)
+   {
+      char value[16];
+      int len = snprintf(value, sizeof(value), "v%d", i);
+
+      lua_pushlstring(L, value, len);
+      lua_pop(L, 1);
+   }
+   misses = now_ms() - start;
+#if defined(LUAI_STROPEN)
+   printf("layout: open addressing, %d slots\n", G(L)->strt.size);
+#else
+   printf("layout: chained, %d buckets\n", G(L)->strt.size);
+#endif
+   printf("%-8s %12s %10s %10s\n", "lookups", "count", "total ms", "ns each");
+   printf("%-8s %12d %10.1f %10.1f\n", "hit", INTERN_HITS, hits, hits * 1e6 / INTERN_HITS);
+   printf("%-8s %12d %10.1f %10.1f\n", "miss", INTERN_MISSES, misses, misses * 1e6 / INTERN_MISSES);
+   free(keys);
+   lua_close(L);
+   luaDestroyMem(pPool);
+}
+
+/*
+* Weak-keyed attribute caches whose values are the keys of other entries: a
+* chain kn -> ... -> k2 -> k1 where only kn is held, linked against the order
+* the keys were created in (and so, mostly, against their order in the
+* table). Every link is found only after the one before it is marked, in the
+* atomic phase. The time is the
+* full collection that proves the whole chain alive; the atomic phase alone
+* is shown when the build keeps collector telemetry (LUAI_GCSTATS).
+*/
+static void bench_ephemeron (void)
+{
+   static const char* setup =
+      "local n = ...\n"
+      "cache = setmetatable({}, { __mode = 'k' })\n"
+      "local keys = {}\n"
+      "for i = 1, n do keys[i] = {} end\n"
+      "for i = 2, n do cache[keys[i]] = keys[i - 1] end\n"
+      "head = keys[n]\n";
+   int n;
+
+   printf("%-10s %12s %12s\n", "chain", "collect ms", "atomic ms");
+   for (n = 2000; n <= 32000; n *= 2)
+   {
+      CMemPool* pPool = luaCreateMem(0, 2048);
+      lua_State* L = lua_newstate(luaMemAlloc, pPool);
+      lua_GCStats stats;
+      double start, ms;
+
+      luaL_openlibs(L);
+      if (luaL_loadstring(L, setup) || (lua_pushinteger(L, n), lua_pcall(L, 1, 0, 0)))
+      {
+         fprintf(stderr, "ephemeron: %s\n", lua_tostring(L, -1));
+      }
+      lua_gc(L, LUA_GCCOLLECT, 0);
+      lua_gc(L, LUA_GCSTATS, 1);
+      start = now_ms();
+      lua_gc(L, LUA_GCCOLLECT, 0);
+      ms = now_ms() - start;
+      if (lua_gcstats(L, &stats))
+      {
+         printf("%-10d %12.1f %12.1f\n", n, ms, stats.phasetime[1] / 1e3);
+      }
+      else
+      {
+         printf("%-10d %12.1f %12s\n", n, ms, "-");
+      }
+      lua_close(L);
+      luaDestroyMem(pPool);
+   }
+}
+
+int main (int argc, char** argv)
+{
+   const char* which = (argc > 1) ? argv[1] : "all";
+
+   if (strcmp(which, "all") == 0 || strcmp(which, "realloc") == 0)
+   {
+      bench_realloc();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "footprint") == 0)
+   {
+      bench_footprint();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "align") == 0)
+   {
+      bench_align();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "states") == 0)
+   {
+      bench_states();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "requests") == 0)
+   {
+      bench_requests();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "buffer") == 0)
+   {
+      bench_buffer();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "hugepage") == 0)
+   {
+      bench_hugepage();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "pressure") == 0)
+   {
+      bench_pressure();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "threads") == 0)
+   {
+      bench_threads();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "trim") == 0)
+   {
+      bench_trim();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "corolimit") == 0)
+   {
+      bench_corolimit();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "gen") == 0)
+   {
+      bench_gen();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "stepus") == 0)
+   {
+      bench_stepus();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "asyncfree") == 0)
+   {
+      bench_asyncfree();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "freebatch") == 0)
+   {
+      bench_freebatch();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "strtab") == 0)
+   {
+      bench_strtab();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "intern") == 0)
+   {
+      bench_intern();
+   }
+   if (strcmp(which, "all") == 0 || strcmp(which, "ephemeron") == 0)
+   {
+      bench_ephemeron();
+   }
+   return 0;
+}